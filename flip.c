@@ -1,45 +1,165 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "libflip_private.h"
 
-#define PROG_NAME "flip"
 #define INSTRUCTIONS "Usage: flip load filename\n\
-    or flip new dim [playerXtype] [playerOtype]"
-/* Byte interval for expanding buffers */
-#define BUFFER_INCREMENT 32
-/* Option constants for board pathfinding */
-#define WALK_VALIDATE 1
-#define WALK_REPLACE 2
-
-typedef unsigned char bool;
-
-/* Game board */
-typedef struct { 
-    char ** s;      /* 2D string-array */
-    unsigned int n; /* Side length */
-    char * border;  /* Border string */
-} boardType;
-
-/* Integer pair */
+    or flip new dim [playerXtype] [playerOtype]\n\
+    or flip bench dim games playerXtype playerOtype\n\
+    or flip perft dim|filename depth [threads]\n\
+    or flip check dim positions [threads]\n\
+    or flip tournament type[:ms],... dim,... games [threads]\n\
+    or flip book build dim plies\n\
+    or flip replay filename\n\
+    or flip train dim games [threads]\n\
+Search AI options: --time ms --nodes count --depth plies --hash MB\n\
+    --threads count --endgame empties --book filename --eval filename\n\
+    --ponder (search while a human opponent thinks)\n\
+    --deadline ms (instead of --time: try to move within ms, & report)\n\
+    (player type 3 is alpha-beta, 4 is Monte Carlo: --nodes counts playouts)\n\
+Record new & bench games: --record filename\n\
+Display: --quiet (moves & score only), --diff (redraw changed cells)\n\
+Input: --batch (read moves from stdin without prompts)\n\
+Profiling: --stats (counters at the end; build with -DFLIP_STATS)\n\
+Engine option: --engine 0-3 (char, 64-bit, wide, incremental)"
+/* Bytes of stdin read at a time; longer lines are split */
+#define INPUT_BUFFER 65536
+/* Per-move output in play: the whole board each move, only the moves 
+    made, or the board drawn once & then just its changed cells, moving 
+    the cursor with ANSI escapes */
+#define DISPLAY_BOARD 0
+#define DISPLAY_MOVES 1
+#define DISPLAY_DIFF 2
+/* Game records: RECORD_MAGIC, then for each game its dim & a code for 
+    each turn (cell x*dim+y as x*dim+y+2, RECORD_PASS), up to RECORD_END,
+    all as varints (7 bits a byte, low first, high bit set if more). A 
+    game left before its end (saved, or out of input) is ended there, so
+    the next game appended starts cleanly. */
+#define RECORD_MAGIC "fliprec1"
+#define RECORD_END 0
+#define RECORD_PASS 1
+#define REPLAY_BUFFER 65536     /* bytes read from a record at a time */
+/* Training: positions held between the game & fitting threads, taken a 
+    batch at a time, the step size per position & the random opening */
+#define TRAIN_RING 65536
+#define TRAIN_BATCH 256
+#define TRAIN_RATE 0.002f
+#define TRAIN_RANDOM_PLIES 6
+#define TRAIN_DEPTH 2           /* self-play search depth if not given */
+/* Tournament games open with random moves, the same for both colourings
+    of a pair of games, as the players themselves may not vary */
+#define TOURNAMENT_RANDOM_PLIES 6
+
+/* A game as the front end plays it: the engine's game state, & the 
+    display, input & record around it, which the engine never sees */
 typedef struct {
-    int a, b;
-} intPair;
+    gameType * game;
+    bool quiet;         /* no per-move output, as in bench games */
+    int display;        /* per-move output when not quiet: DISPLAY_* */
+    char * frame;       /* output for a turn, written all at once */
+    int frameLen, frameSize;
+    char * input;       /* stdin read ahead, split into lines in place */
+    int inputAt, inputLen;
+    long inputLine;     /* lines read so far */
+    bool batch;         /* moves from stdin with no prompts */
+    bool showStats;     /* report the profiling counters at the end */
+    bool ponder;        /* search while a human player thinks */
+    FILE * record;      /* move log being written, or NULL */
+} sessionType;
+
+/* Tournament entrant: an AI type & its search limits */
+typedef struct {
+    char * name;        /* as given on the command line */
+    int type;
+    searchLimitsType limits;
+} entrantType;
+
+/* Round-robin tournament, shared by the worker threads. Game 'job' is 
+    game job % games between pair job / (games * nDims) on board size 
+    (job / games) % nDims. */
+typedef struct {
+    entrantType * players;
+    int nPlayers;
+    int * dims;
+    int nDims;
+    int games;          /* per pair of players & board size */
+    int * pairA, * pairB;   /* players in each pairing */
+    int nJobs;
+    int next;           /* next game to hand out */
+    signed char * results;  /* per game: 1 if pairA won, -1 lost, 0 drawn */
+    long ttMb;
+    char * bookPath;
+    char * evalPath;
+} tournamentType;
+
+/* A self-play position for training: the pattern indices, as in the 
+    game's evalIndex, & the terms eval_score adds to them */
+typedef struct {
+    int32_t index[EVAL_PATTERNS];
+    int16_t margin;     /* discs, O - X */
+    int16_t label;      /* final disc margin, O - X */
+    int8_t moves;       /* valid moves for the mover, up to EVAL_MOVES-1 */
+    int8_t sign;        /* 1 if O is to move, -1 for X */
+} trainSampleType;
+
+/* Self-play training: game threads fill a ring buffer of positions, which
+    fitting threads empty into the weights */
+typedef struct {
+    int dim, games;
+    int next;           /* next game to hand out */
+    searchLimitsType limits;    /* for the self-play search */
+    long ttMb;
+    char * evalPath;    /* weights to start from & write, or NULL */
+    float * weights;    /* being fitted: EVAL_WEIGHTS */
+    pthread_mutex_t lock;       /* guards the ring & the counts */
+    pthread_cond_t notEmpty, notFull;
+    trainSampleType * ring;     /* TRAIN_RING positions */
+    int head, count;
+    int playing;        /* game threads still running */
+    long samples;
+    long windowSamples; /* error over positions since the last window */
+    double windowError, lastError;
+} trainType;
+
+/* Search on a copy of the game, run while input_turn waits for a human
+    player's move: of the position after the reply the AI's last search 
+    expects, else of every reply. The AI's next search finds the work in
+    the shared transposition table, & on a correct guess the time too. */
+typedef struct {
+    pthread_t thread;
+    gameType game;
+    int reply;          /* move made on the copy, or -1 */
+    int abort;          /* set once the move arrives */
+    bool running;
+} ponderType;
 
-/* Full game state */
+/* Record being replayed, read a buffer at a time */
 typedef struct {
-    int passes; /* if last turn was a pass */
-    int pTypeO, pTypeX; /* player type: 0..2 */
-    int scoreO, scoreX; /* player scores */
-    char * filepath;    /* filepath last used */
-    char whoseTurn;     /* current player: O,X */
-    boardType board;    /* board state */
-    boardType validMove;/* positions avilable to current player */
-} gameType;
-
-/* (x,y) movement vectors for all 8 paths from a tile */
-const int vect[8][2] = { {-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, \
-    {0, 1}, {1, -1}, {1,  0}, {1,  1}  };
+    FILE * f;
+    unsigned char buf[REPLAY_BUFFER];
+    size_t at, len;
+} replayType;
+
+/* Perft state shared by the threads splitting the root moves */
+typedef struct {
+    int * moves;        /* root moves (-1 for a pass) */
+    int nMoves;
+    int next;           /* next root move to hand out */
+    int depth;
+    long * counts;      /* leaf positions under each root move */
+} perftSharedType;
+
+/* Perft state for one thread */
+typedef struct {
+    gameType * game;
+    int * moves;        /* move lists for each ply on the current line */
+    perftSharedType * shared;
+} perftType;
 
 /* ------------------------------------------------------------------------- */
 
@@ -53,44 +173,76 @@ int isdigit (int c);
 int main (int argc, char * argv[]);
 
 /* Input & parsing */
-void input_turn (gameType * game);
-void parse_ini (int argc, char * argv[], gameType * game);
-void parse_setup (int argc, char * argv[], gameType * game);
-void parse_turn (int argc, char * arg1, char * arg2, gameType * game);
+void input_turn (sessionType * s);
+void parse_ini (int argc, char * argv[], sessionType * s);
+void parse_setup (int argc, char * argv[], sessionType * s);
+bool parse_turn (char * line, sessionType * s);
+char * input_line (sessionType * s);
+bool input_coords (char * line, int * x, int * y);
+void parse_options (int * argc, char * argv[], sessionType * s);
+void parse_bench (int argc, char * argv[], sessionType * s);
+void parse_perft (int argc, char * argv[], gameType * game);
+void parse_check (int argc, char * argv[], gameType * game);
+void parse_tournament (int argc, char * argv[], gameType * game);
+void parse_book (char * argv[], gameType * game);
+void parse_replay (char * argv[], gameType * game);
+void parse_train (int argc, char * argv[], gameType * game);
 
 /* High-level gameplay */
-void play (gameType * game);
-void turn_decision(gameType * game);
-void player_try_move (int x, int y, gameType * game);
-void ai_turn (int playerType, gameType * game);
-
-/* Boardgame engine */
-bool board_walk(int x, int y, int dx, int dy, char tile, \
-                boardType * board, int action);
-bool move_valid (int x, int y, char tile, boardType * board);
-void game_update_valid_moves (gameType * game);
-void game_put_tile (int x, int y, gameType * game);
-
-/* Game state, memory management and R/W */
-void game_ini (gameType * game);
-void game_set_fname (char * fname, gameType *game);
-void game_load (char * fname, gameType * game);
-void game_save (char * fname, gameType * game);
-void game_next_player (gameType * game);
-void game_update_scoring (gameType *game);
-/**/
-void board_ini (boardType * board, unsigned int size);
-void board_cleanup (boardType *board);
-void board_print (boardType * board);
-bool board_missing_char (char c, boardType * board);
-void board_free (boardType * board);
+void session_ini (sessionType * s, gameType * game);
+void play (sessionType * s);
+int turn_decision(sessionType * s);
+bool player_try_move (int x, int y, sessionType * s);
+void ai_turn (int playerType, sessionType * s);
+void bench (sessionType * s, int games);
+void board_print (sessionType * s);
+void board_diff (sessionType * s);
+
+/* Move generation tests */
+void perft (gameType * game, int depth, int threads);
+void * perft_root_moves (void * perft);
+long perft_count (gameType * game, int depth, int * moves);
+
+/* Search tests */
+void check (gameType * game, int positions, int threads);
+int check_value (gameType * game, int move);
+
+/* Tournaments */
+void tournament (tournamentType * t, int threads);
+void * tournament_games (void * t);
+int tournament_game (tournamentType * t, int job, gameType * board);
+void tournament_report (tournamentType * t, double seconds, int threads);
+
+/* Training */
+void train (trainType * t, int threads);
+void * train_games (void * t);
+void * train_fit (void * t);
+
+/* Pondering */
+void ponder_start (ponderType * p, sessionType * s);
+void ponder_stop (ponderType * p, sessionType * s);
+void * ponder_search (void * p);
+
+/* Output */
+void frame_printf (sessionType * s, const char * format, ...);
+void frame_flush (sessionType * s);
+void frame_end (sessionType * s);
+void stats_report (gameType * game);
+void deadline_report (gameType * game);
+
+/* Game records */
+void record_start (sessionType * s);
+void record_move (int pos, sessionType * s);
+void record_end (sessionType * s);
+void record_varint (unsigned long value, FILE * f);
+void replay (replayType * log);
+bool replay_varint (replayType * log, unsigned long * value);
 
 /* System messages & exit actions */
 void sysMessage (int msgId, gameType *game);
 
 /* String utilities */
 bool string_is_numeric (char * s);
-int string_find (char * s, char c);
 void string_strip_nondigit (char * s);
 
 
@@ -98,9 +250,12 @@ void string_strip_nondigit (char * s);
 
 int main (int argc, char * argv[]) {
     gameType game;
+    sessionType session;
     
     game_ini(&game);
-    parse_ini(argc, argv, &game);
+    session_ini(&session, &game);
+    parse_options(&argc, argv, &session);
+    parse_ini(argc, argv, &session);
     
     return 0;
 }
@@ -110,78 +265,90 @@ int main (int argc, char * argv[]) {
 
 /* Input & parsing */
 
-void input_turn(gameType * game) {
+void input_turn(sessionType * s) {
     /*
-        Read and split player input into arguments for the parser
+        Read a line of player input & act on it. In batch mode there is no 
+            prompt, & lines which aren't valid moves are reported.
     */
-    int pos;
-    int bufUsed = 0, bufSize = BUFFER_INCREMENT;
-    char * buf, * arg1, * arg2, * temp, c;
-    
-    printf("Player (%c)> ", game->whoseTurn);
+    gameType * game = s->game;
+    char * line;
+    ponderType ponder;
+    STATS_TIMER(timer)
     
-    /* Read stdin to buffer */
-    buf = (char *) malloc(sizeof(char) * bufSize);
-    while ( (c = getchar()) != '\n' && !feof(stdin) ) {
-        bufUsed++;
-        /* Expand memory if needed */
-        if (bufSize <= bufUsed) {
-            bufSize += BUFFER_INCREMENT;
-            temp = (char *) malloc(sizeof(char) * bufSize);
-            memcpy(temp, buf, sizeof(char) * bufSize-BUFFER_INCREMENT);
-            buf = temp;
-			free(temp);
-        }
-        buf[bufUsed-1] = c;
+    if (!s->batch) {
+        frame_printf(s, "Player (%c)> ", game->whoseTurn);
+        frame_flush(s);
     }
-    buf[bufUsed] = '\0';
-    /* Catch EoF-only input */
-    if ((bufUsed == 0) && (c != '\n')) {
+    ponder_start(&ponder, s);
+    STATS_START(timer);
+    line = input_line(s);
+    STATS_STOP(game, STATS_INPUT, timer);
+    ponder_stop(&ponder, s);
+    if (line == NULL) {
+        record_end(s);
+        frame_end(s);
         sysMessage(10, game);
     }
-    
-	if (buf[0]=='s') {
-		
-		/* Save file */
-		parse_turn(1, buf, "", game);
-		
-	} else {
-		
-		/* Play a turn */
-		pos = string_find(buf, ' ');
-		if (pos > 0) {
-			/* Two arguments */
-			arg1 = (char *) malloc( sizeof(char) * (pos+1) );
-			arg2 = (char *) malloc( sizeof(char) * (bufUsed-pos) );
-			memcpy( arg1, &buf[0], sizeof(char) * pos);
-			memcpy( arg2, &buf[pos+1], sizeof(char) * (bufUsed-pos-1));
-			arg1[pos] = '\0';
-			arg2[strlen(buf)-pos-1] = '\0';
-			/* Send to parser and free memory */
-			parse_turn(2, arg1, arg2, game);
-			free(arg1);
-			free(arg2);
-		}
-	}
-	free(buf);
+    if (!parse_turn(line, s) && s->batch) {
+        fprintf(stderr, "Line %ld: invalid move for %c: %s\n", 
+                s->inputLine, game->whoseTurn, line);
+    }
 }
 
-void parse_ini (int argc, char * argv[], gameType * game) {
+void parse_ini (int argc, char * argv[], sessionType * s) {
     /* 
      Decide on action to take on startup
      */
+    gameType * game = s->game;
+    
     if (argc == 1) {
         /* No parameters */
         sysMessage(1, game);
         
     } else if (!strcmp(argv[1], "new") && (argc > 2) && (argc <= 5)) {
         /* Start new game */
-        parse_setup(argc, argv, game);
+        parse_setup(argc, argv, s);
         
     } else if (!strcmp(argv[1], "load") && (argc == 3)) {
-        /* Load a game */
-        game_load(argv[2], game);
-        play(game);
+        /* Load a game: records only start from a new game */
+        if (game_load(argv[2], game) != FLIP_OK) {
+            sysMessage(7, game);
+        }
+        if (s->record != NULL) {
+            fclose(s->record);
+            s->record = NULL;
+        }
+        play(s);
+        
+    } else if (!strcmp(argv[1], "bench") && (argc == 6)) {
+        /* Time headless AI games */
+        parse_bench(argc, argv, s);
+        
+    } else if (!strcmp(argv[1], "perft") && (argc >= 4) && (argc <= 5)) {
+        /* Count & time move generation */
+        parse_perft(argc, argv, game);
+        
+    } else if (!strcmp(argv[1], "check") && (argc >= 4) && (argc <= 5)) {
+        /* Check searches against the evaluation */
+        parse_check(argc, argv, game);
+        
+    } else if (!strcmp(argv[1], "tournament") && (argc >= 5) && \
+               (argc <= 6)) {
+        /* Play AI types against each other */
+        parse_tournament(argc, argv, game);
+        
+    } else if (!strcmp(argv[1], "book") && (argc == 5) && \
+               !strcmp(argv[2], "build")) {
+        /* Make an opening book */
+        parse_book(argv, game);
+        
+    } else if (!strcmp(argv[1], "train") && (argc >= 4) && (argc <= 5)) {
+        /* Fit evaluation weights by self-play */
+        parse_train(argc, argv, game);
+        
+    } else if (!strcmp(argv[1], "replay") && (argc == 3)) {
+        /* Check & score recorded games */
+        parse_replay(argv, game);
         
     } else {
         /* Wrong parameters */
@@ -189,10 +356,11 @@ void parse_ini (int argc, char * argv[], gameType * game) {
     }
 }
 
-void parse_setup (int argc, char * argv[], gameType * game) {
+void parse_setup (int argc, char * argv[], sessionType * s) {
     /*
      Process arguments from main() for starting a game
      */
+    gameType * game = s->game;
     int a, b = 0, c = 0, i;
 	
 	/* Strip non-integer characters after the last argument */
@@ -223,7 +391,8 @@ void parse_setup (int argc, char * argv[], gameType * game) {
         /* Boardsize is invalid */
         sysMessage(5, game);
         
-    } else if ( (b > 2) || (c > 2) || (b < 0) || (c < 0) ) {
+    } else if ( (b > PLAYER_TYPE_MAX) || (c > PLAYER_TYPE_MAX) || \
+                (b < 0) || (c < 0) ) {
         /* Player selection is invalid */
         sysMessage(6, game);
         
@@ -231,53 +400,499 @@ void parse_setup (int argc, char * argv[], gameType * game) {
         /* Valid game start condition! */
         board_ini(&game->board, a);
         board_ini(&game->validMove, a);
+        game_set_engine(game);
         game->pTypeX = b;
         game->pTypeO = c;
-        play(game);
+        record_start(s);
+        play(s);
     }
 }
 
-void parse_turn (int argc, char * arg1, char * arg2, gameType * game) {
+bool parse_turn (char * line, sessionType * s) {
     /*
      Decide on an action to take with player input: 
-     make a move, save a file or exit
+     make a move, save a file or exit. Returns whether a move was made.
      */
+    gameType * game = s->game;
     int a, b;
-    char * fname;
     
-    /* Save */
-    if (argc == 1) {
-        
-        /* Check filename given */
-        /*if (strlen(arg1) == 1) {
-            sysMessage(9, game);
-        }*/
-        
-        /* Strip out first character for filename & save */
-        fname = (char *) malloc(strlen(arg1));
-        fname = strncpy(fname, &arg1[1], strlen(arg1) - 1);
-        fname[strlen(arg1)] = '\0';
-        game_save(fname, game);
-        free(fname);
+    /* Save: the rest of the line is the filename */
+    if (line[0] == 's') {
+        switch (game_save(&line[1], game)) {
+            case FLIP_OK:
+                record_end(s);
+                frame_end(s);
+                sysMessage(4, game);
+                break;
+            case FLIP_ERR_NAME:
+                sysMessage(9, game);
+                break;
+            default:
+                sysMessage(8, game);
+                break;
+        }
+        return 0;
     }
+    
     /* Place piece */
-    else if (argc == 2) {
-        
-        /* Check positive integers given */
-		string_strip_nondigit(arg2);
-        if (!( string_is_numeric(arg1) && string_is_numeric(arg2) )) {
-            return;
+    if (!input_coords(line, &a, &b)) {
+        return 0;
+    }
+    return player_try_move(a, b, s);
+}
+
+char * input_line (sessionType * s) {
+    /*
+        Return the next line of stdin, ended in place in the read buffer, 
+            or NULL at the end of input. Each byte is looked at once; a 
+            line longer than the buffer comes back in pieces.
+    */
+    char * line, * end;
+    int from, len;
+    
+    if (s->input == NULL) {
+        s->input = (char *) malloc(INPUT_BUFFER + 1);
+    }
+    from = s->inputAt;
+    while (1) {
+        end = (char *) memchr(&s->input[from], '\n', 
+                              s->inputLen - from);
+        if (end != NULL) {
+            *end = '\0';
+            line = &s->input[s->inputAt];
+            s->inputAt = end - s->input + 1;
+            s->inputLine++;
+            return line;
         }
-        /* Check integers did not overflow */
-        a = atoi(arg1);
-        b = atoi(arg2);
-        if ((a == INT_MAX) || (b == INT_MAX) || (a < 0) || (b < 0)) {
-            return;
+        /* keep the partial line, moved to the front, & read more */
+        memmove(s->input, &s->input[s->inputAt], 
+                s->inputLen - s->inputAt);
+        s->inputLen -= s->inputAt;
+        s->inputAt = 0;
+        from = s->inputLen;
+        len = 0;
+        if (s->inputLen < INPUT_BUFFER) {
+            len = read(STDIN_FILENO, &s->input[s->inputLen], 
+                       INPUT_BUFFER - s->inputLen);
         }
-        
-        /* Perform the move */
-        player_try_move(a, b, game);
+        if (len > 0) {
+            s->inputLen += len;
+            continue;
+        }
+        /* end of input, or a full buffer: what's left is a line */
+        if (s->inputLen == 0) {
+            return NULL;
+        }
+        s->input[s->inputLen] = '\0';
+        s->inputAt = 0;
+        s->inputLen = 0;
+        s->inputLine++;
+        return s->input;
+    }
+}
+
+bool input_coords (char * line, int * x, int * y) {
+    /*
+        Read 'x y' from a line in one pass: digits, a space, then digits up
+            to the first other character. Returns 0 if malformed or too big.
+    */
+    char * s = line, * start;
+    
+    *x = 0;
+    for (start = s; isdigit(*s); s++) {
+        if (*x > (INT_MAX - 9) / 10) {
+            return 0;
+        }
+        *x = 10 * *x + (*s - '0');
+    }
+    if ((s == start) || (*s != ' ')) {
+        return 0;
+    }
+    *y = 0;
+    for (start = ++s; isdigit(*s); s++) {
+        if (*y > (INT_MAX - 9) / 10) {
+            return 0;
+        }
+        *y = 10 * *y + (*s - '0');
+    }
+    return s != start;
+}
+
+void parse_options (int * argc, char * argv[], sessionType * s) {
+    /*
+        Apply & remove '--name value' options from the arguments, so the 
+            rest can be parsed by position
+    */
+    gameType * game = s->game;
+    int i, kept = 0;
+    long value;
+    
+    for (i = 0; i < *argc; i++) {
+        if (strncmp(argv[i], "--", 2)) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        /* the book, weights & record are the options taking a name */
+        if (!strcmp(argv[i], "--book") && (i+1 < *argc)) {
+            game->bookPath = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "--eval") && (i+1 < *argc)) {
+            game->evalPath = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "--record") && (i+1 < *argc)) {
+            s->record = fopen(argv[++i], "ab");
+            if (s->record == NULL) {
+                game_set_fname(argv[i], game);
+                sysMessage(8, game);
+            } else if (ftell(s->record) == 0) {
+                fwrite(RECORD_MAGIC, 1, strlen(RECORD_MAGIC), s->record);
+            }
+            continue;
+        }
+        /* the display options take no value */
+        if (!strcmp(argv[i], "--quiet")) {
+            s->display = DISPLAY_MOVES;
+            continue;
+        }
+        if (!strcmp(argv[i], "--diff")) {
+            s->display = DISPLAY_DIFF;
+            continue;
+        }
+        if (!strcmp(argv[i], "--batch")) {
+            s->batch = 1;
+            continue;
+        }
+        if (!strcmp(argv[i], "--stats")) {
+            s->showStats = 1;
+            continue;
+        }
+        if (!strcmp(argv[i], "--ponder")) {
+            s->ponder = 1;
+            continue;
+        }
+        /* every other option takes a whole number */
+        if ((i+1 >= *argc) || !string_is_numeric(argv[i+1])) {
+            sysMessage(11, game);
+        }
+        value = atol(argv[++i]);
+        if (!strcmp(argv[i-1], "--time")) {
+            (game->limits).timeMs = value;
+        } else if (!strcmp(argv[i-1], "--deadline")) {
+            (game->limits).deadlineMs = value;
+            (game->limits).timeMs = 0;
+        } else if (!strcmp(argv[i-1], "--nodes")) {
+            (game->limits).nodes = value;
+        } else if (!strcmp(argv[i-1], "--depth")) {
+            (game->limits).depth = value;
+        } else if (!strcmp(argv[i-1], "--hash") && (value > 0)) {
+            game->ttMb = value;
+        } else if (!strcmp(argv[i-1], "--threads") && (value > 0) && \
+                   (value <= SEARCH_MAX_THREADS)) {
+            game->threads = value;
+        } else if (!strcmp(argv[i-1], "--endgame")) {
+            game->endgame = value;
+        } else if (!strcmp(argv[i-1], "--engine") && (value <= ENGINE_MAX)) {
+            game->engineOption = value;
+        } else {
+            sysMessage(11, game);
+        }
+    }
+    *argc = kept;
+}
+
+
+void parse_bench (int argc, char * argv[], sessionType * s) {
+    /*
+        Process arguments from main() for a benchmark: dim, number of 
+            games & two AI player types
+    */
+    gameType * game = s->game;
+    int i, games;
+    
+    for (i = 2; i < argc; i++) {
+        if (!string_is_numeric(argv[i])) {
+            sysMessage((i == 2) ? 5 : 11, game);
+        }
+    }
+    if (atoi(argv[2]) <= 3) {
+        sysMessage(5, game);
+    }
+    games = atoi(argv[3]);
+    game->pTypeX = atoi(argv[4]);
+    game->pTypeO = atoi(argv[5]);
+    if (games <= 0) {
+        sysMessage(11, game);
+    }
+    /* nobody to ask for a human player's moves */
+    if ((game->pTypeX < 1) || (game->pTypeX > PLAYER_TYPE_MAX) || \
+        (game->pTypeO < 1) || (game->pTypeO > PLAYER_TYPE_MAX)) {
+        sysMessage(6, game);
+    }
+    board_ini(&game->board, atoi(argv[2]));
+    board_ini(&game->validMove, atoi(argv[2]));
+    game_set_engine(game);
+    bench(s, games);
+}
+
+
+void parse_perft (int argc, char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for perft: a board size (for a new 
+            game) or save file, the depth & optionally a thread count
+    */
+    int depth, threads = 1;
+    
+    if (!string_is_numeric(argv[3]) || \
+        ((argc == 5) && !string_is_numeric(argv[4]))) {
+        sysMessage(11, game);
+    }
+    depth = atoi(argv[3]);
+    if (argc == 5) {
+        threads = atoi(argv[4]);
+    }
+    if ((threads < 1) || (threads > SEARCH_MAX_THREADS)) {
+        sysMessage(11, game);
+    }
+    if (string_is_numeric(argv[2])) {
+        if (atoi(argv[2]) <= 3) {
+            sysMessage(5, game);
+        }
+        board_ini(&game->board, atoi(argv[2]));
+        board_ini(&game->validMove, atoi(argv[2]));
+        game_set_engine(game);
+    } else if (game_load(argv[2], game) != FLIP_OK) {
+        sysMessage(7, game);
+    }
+    perft(game, depth, threads);
+}
+
+void parse_check (int argc, char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for a search check: dim, number of 
+            positions & optionally a thread count
+    */
+    int i, positions, threads = 1;
+    
+    for (i = 2; i < argc; i++) {
+        if (!string_is_numeric(argv[i])) {
+            sysMessage((i == 2) ? 5 : 11, game);
+        }
+    }
+    if (atoi(argv[2]) <= 3) {
+        sysMessage(5, game);
+    }
+    positions = atoi(argv[3]);
+    if (argc == 5) {
+        threads = atoi(argv[4]);
+    }
+    if ((positions <= 0) || (threads < 1) || \
+        (threads > SEARCH_MAX_THREADS)) {
+        sysMessage(11, game);
+    }
+    board_ini(&game->board, atoi(argv[2]));
+    board_ini(&game->validMove, atoi(argv[2]));
+    game_set_engine(game);
+    check(game, positions, threads);
+}
+
+
+void parse_tournament (int argc, char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for a tournament: comma-separated 
+            entrants (an AI type, & for AI_SEARCH or AI_MCTS optionally ':'
+            and its milliseconds per move) & board sizes, the games per pairing 
+            & size, and optionally a thread count
+    */
+    tournamentType t;
+    int i, j, threads = 1;
+    char * item, * ms;
+    
+    if (!string_is_numeric(argv[4]) || \
+        ((argc == 6) && !string_is_numeric(argv[5]))) {
+        sysMessage(11, game);
+    }
+    t.games = atoi(argv[4]);
+    if (argc == 6) {
+        threads = atoi(argv[5]);
+    }
+    if ((t.games <= 0) || (threads < 1) || (threads > SEARCH_MAX_THREADS)) {
+        sysMessage(11, game);
+    }
+    /* entrants: the search limits default to the command line's */
+    t.nPlayers = 0;
+    t.players = (entrantType *) malloc(strlen(argv[2]) * sizeof(entrantType));
+    for (item = strtok(argv[2], ","); item; item = strtok(NULL, ",")) {
+        t.players[t.nPlayers].name = item;
+        t.players[t.nPlayers].limits = game->limits;
+        ms = strchr(item, ':');
+        if (ms != NULL) {
+            *ms++ = '\0';
+            if (!string_is_numeric(ms)) {
+                sysMessage(6, game);
+            }
+            t.players[t.nPlayers].limits.timeMs = atol(ms);
+        }
+        t.players[t.nPlayers].type = atoi(item);
+        if (!string_is_numeric(item) || (atoi(item) < 1) || \
+            (atoi(item) > PLAYER_TYPE_MAX)) {
+            sysMessage(6, game);
+        }
+        if (ms != NULL) {
+            ms[-1] = ':';
+        }
+        t.nPlayers++;
+    }
+    t.nDims = 0;
+    t.dims = (int *) malloc(strlen(argv[3]) * sizeof(int));
+    for (item = strtok(argv[3], ","); item; item = strtok(NULL, ",")) {
+        if (!string_is_numeric(item) || (atoi(item) <= 3)) {
+            sysMessage(5, game);
+        }
+        t.dims[t.nDims++] = atoi(item);
+    }
+    if ((t.nPlayers < 2) || (t.nDims < 1)) {
+        sysMessage(11, game);
+    }
+    /* every player meets every other */
+    t.pairA = (int *) malloc(t.nPlayers * t.nPlayers * sizeof(int));
+    t.pairB = (int *) malloc(t.nPlayers * t.nPlayers * sizeof(int));
+    t.nJobs = 0;
+    for (i = 0; i < t.nPlayers; i++) {
+        for (j = i+1; j < t.nPlayers; j++) {
+            t.pairA[t.nJobs] = i;
+            t.pairB[t.nJobs++] = j;
+        }
+    }
+    t.nJobs *= t.nDims * t.games;
+    t.ttMb = game->ttMb;
+    t.bookPath = game->bookPath;
+    t.evalPath = game->evalPath;
+    tournament(&t, threads);
+    free(t.players);
+    free(t.dims);
+    free(t.pairA);
+    free(t.pairB);
+    free(game->filepath);
+}
+
+
+void parse_book (char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for building an opening book: the 
+            board size & how many moves into the game it covers
+    */
+    long count;
+    double start;
+    
+    if (!string_is_numeric(argv[3]) || (atoi(argv[3]) <= 3)) {
+        sysMessage(5, game);
+    }
+    if (!string_is_numeric(argv[4])) {
+        sysMessage(11, game);
+    }
+    board_ini(&game->board, atoi(argv[3]));
+    board_ini(&game->validMove, atoi(argv[3]));
+    game_set_engine(game);
+    start = search_clock();
+    if (book_build(game, atoi(argv[4]), game->bookPath, &count) != FLIP_OK) {
+        game_set_fname((game->bookPath != NULL) ? game->bookPath : "book", \
+                       game);
+        sysMessage(8, game);
+    } else {
+        printf("Book: %ld positions up to %d moves in %.3fs\n", count, 
+               atoi(argv[4]), search_clock() - start);
+    }
+    game_free(game);
+}
+
+
+void parse_replay (char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for replaying a game record
+    */
+    replayType * log = (replayType *) malloc(sizeof(replayType));
+    char magic[8];
+    
+    game_set_fname(argv[2], game);
+    log->f = fopen(argv[2], "rb");
+    if ((log->f == NULL) || \
+        (fread(magic, 1, strlen(RECORD_MAGIC), log->f) != strlen(RECORD_MAGIC))
+        || memcmp(magic, RECORD_MAGIC, strlen(RECORD_MAGIC))) {
+        sysMessage(7, game);
     }
+    log->at = 0;
+    log->len = 0;
+    replay(log);
+    fclose(log->f);
+    free(log);
+    free(game->filepath);
+}
+
+
+void parse_train (int argc, char * argv[], gameType * game) {
+    /*
+        Process arguments from main() for training: the board size, the 
+            number of self-play games & optionally a thread count. The 
+            self-play search uses the command line's limits, or 
+            TRAIN_DEPTH plies if no depth is given.
+    */
+    trainType t;
+    int i, threads = 1;
+    evalType * eval;
+    int16_t * weights;
+    
+    if (!string_is_numeric(argv[2]) || (atoi(argv[2]) <= 3)) {
+        sysMessage(5, game);
+    }
+    if (!string_is_numeric(argv[3]) || \
+        ((argc == 5) && !string_is_numeric(argv[4]))) {
+        sysMessage(11, game);
+    }
+    t.dim = atoi(argv[2]);
+    t.games = atoi(argv[3]);
+    if (argc == 5) {
+        threads = atoi(argv[4]);
+    }
+    if ((t.games <= 0) || (threads < 1) || (threads > SEARCH_MAX_THREADS)) {
+        sysMessage(11, game);
+    }
+    t.limits = game->limits;
+    if (t.limits.depth <= 0) {
+        t.limits.depth = TRAIN_DEPTH;
+        if (t.limits.timeMs == SEARCH_TIME_MS) {
+            t.limits.timeMs = 0;
+        }
+    }
+    t.ttMb = game->ttMb;
+    t.evalPath = game->evalPath;
+    
+    /* start from the weights the engine would use now */
+    board_ini(&game->board, t.dim);
+    eval = eval_open(t.evalPath, &game->board);
+    t.weights = (float *) malloc(EVAL_WEIGHTS * sizeof(float));
+    for (i = 0; i < EVAL_WEIGHTS; i++) {
+        t.weights[i] = eval->weights[i];
+    }
+    eval_close(eval);
+    board_free(&game->board);
+    
+    train(&t, threads);
+    
+    weights = (int16_t *) malloc(EVAL_WEIGHTS * sizeof(int16_t));
+    for (i = 0; i < EVAL_WEIGHTS; i++) {
+        weights[i] = (t.weights[i] > INT16_MAX) ? INT16_MAX : \
+                     (t.weights[i] < INT16_MIN) ? INT16_MIN : \
+                     (int16_t) lrintf(t.weights[i]);
+    }
+    if (eval_save(t.evalPath, t.dim, weights) != FLIP_OK) {
+        game_set_fname((t.evalPath != NULL) ? t.evalPath : "weights", game);
+        sysMessage(8, game);
+    }
+    free(weights);
+    free(t.weights);
+    free(game->filepath);
 }
 
 
@@ -285,460 +900,1306 @@ void parse_turn (int argc, char * arg1, char * arg2, gameType * game) {
 
 /* High-level gameplay */
 
-void play (gameType * game) {
+void session_ini (sessionType * s, gameType * game) {
+    /*
+        Start a front end for a game, with the full board display & no 
+            input read or record open yet
+    */
+    s->game = game;
+    s->quiet = 0;
+    s->display = DISPLAY_BOARD;
+    s->frame = NULL;
+    s->frameLen = 0;
+    s->frameSize = 0;
+    s->input = NULL;
+    s->inputAt = 0;
+    s->inputLen = 0;
+    s->inputLine = 0;
+    s->batch = 0;
+    s->showStats = 0;
+    s->ponder = 0;
+    s->record = NULL;
+}
+
+void play (sessionType * s) {
     /*
         Gameplay loop
     */
+    gameType * game = s->game;
+    int end;
     
-    board_print(&game->board);
-    while (1) {
-        turn_decision(game);
+    if (s->display == DISPLAY_DIFF) {
+        /* board at the top, with the text scrolling below it */
+        frame_printf(s, "\033[2J\033[H");
+        board_print(s);
+        frame_printf(s, "\033[%d;r\033[%d;1H", (game->board).n + 3, 
+                     (game->board).n + 3);
+    } else if (s->display == DISPLAY_BOARD) {
+        board_print(s);
+    }
+    frame_flush(s);
+    while ((end = turn_decision(s)) == GAME_ON);
+    record_end(s);
+    if (s->showStats) {
+        stats_report(game);
     }
+    deadline_report(game);
+    frame_end(s);
+    sysMessage(end, game);
 }
 
-void turn_decision (gameType * game) {
+int turn_decision (sessionType * s) {
     /*
-        Make a decision on what to do in a turn, based on game state
+        Make a decision on what to do in a turn, based on game state.
+            Returns GAME_ON, or how the game ended (GAME_FULL/BLOCKED).
     */
+    gameType * game = s->game;
     char player;
     
-    /* Refresh background information */
+    /* Refresh background information (scores are kept by game_put_tile) */
     player = game->whoseTurn;
     game_update_valid_moves(game);
-    game_update_scoring(game);
     
     /* Board is full: end the game */
-    if (board_missing_char('.', &game->board)) {
-        sysMessage(2, game);
+    if (game->empties == 0) {
+        return GAME_FULL;
     }
     
     /* Player has no move options: pass */
-    else if (board_missing_char(player, &game->validMove)) {
+    else if (game->nMoves == 0) {
 
-        printf("%c passes.\n", game->whoseTurn);
+        if (!s->quiet) {
+            frame_printf(s, "%c passes.\n", game->whoseTurn);
+            frame_flush(s);
+        }
+        record_move(-1, s);
         game_next_player(game);
         (game->passes)++;
         
         /* Both players passed: end the game */
         if (game->passes > 1) {
-            sysMessage(3, game);
+            return GAME_BLOCKED;
         }
-        return;
     }
     
     /* AI player: place a tile */
     else if ((player == 'O') && ((game->pTypeO) != 0)) {
-        ai_turn(game->pTypeO, game);
+        ai_turn(game->pTypeO, s);
     } else if ((player == 'X') && ((game->pTypeX) != 0)) {
-        ai_turn(game->pTypeX, game);
+        ai_turn(game->pTypeX, s);
     }
     
     /* Human player: input prompt */
     else {
-        input_turn(game);
-    }   
+        input_turn(s);
+    }
+    return GAME_ON;
 }
 
-void player_try_move (int x, int y, gameType * game) {
+bool player_try_move (int x, int y, sessionType * s) {
     /*
-        Check if a player's choice is available and execute
+        Check if a player's choice is available and execute; returns 
+            whether it was
     */
+    gameType * game = s->game;
     
     /* Check position is within board */
     if ( (x > (game->board).n-1) || (y > (game->board).n-1) ) {
-        return;
+        return 0;
     }
     
     /* Check position is a valid move */
-    if ( (game->validMove).s[x][y] != game->whoseTurn ) {
-        return;
+    if ( CELL(&game->validMove, x, y) != game->whoseTurn ) {
+        return 0;
     }
         
     /* Place tile, display & prepare for the next player */
-    game_put_tile(x, y, game);
-    board_print(&game->board);
+    record_move(BOARD_POS(&game->board, x, y), s);
+    game_put_tile(BOARD_POS(&game->board, x, y), game);
+    if (s->display == DISPLAY_MOVES) {
+        frame_printf(s, "Player %c moves at %d %d.\n", game->whoseTurn, 
+                     x, y);
+    } else if (s->display == DISPLAY_DIFF) {
+        board_diff(s);
+    } else {
+        board_print(s);
+    }
+    frame_flush(s);
     game_next_player(game);
     game->passes = 0;
+    return 1;
 }
 
-void ai_turn (int playerType, gameType * game) {
+void ai_turn (int playerType, sessionType * s) {
     /*
-        Parse through the valid moves using one of the AI types
+        Choose a valid move using one of the AI types & play it
      */
-    int x, y, dy, size;
-    size = (game->validMove).n;
-    
-    /* Choose an AI search pattern */
-    if (playerType == 1) {
-        x = 0;
-        y = 0;
-        dy = 1;
-    } else {
-        x = size-1;
-        y = size-1;
-        dy = -1;
+    gameType * game = s->game;
+    searchInfoType * info = &game->lastSearch;
+    int pos, x, y;
+    
+    pos = ai_choose(playerType, game);
+    if (pos < 0) {
+        record_end(s);
+        sysMessage(0, game);
+    }
+    x = pos / (game->board).stride - 1;
+    y = pos % (game->board).stride - 1;
+    if (s->display == DISPLAY_MOVES) {
+        /* no search reports */
+    } else if ((playerType == AI_SEARCH) && !s->quiet && info->book) {
+        fprintf(stderr, "Book: score %d\n", info->score);
+    } else if ((playerType == AI_SEARCH) && !s->quiet && info->solved) {
+        fprintf(stderr, "Solved: %s by %d with %d empties, nodes %ld time "
+                "%.3fs (%.0f nodes/s)\n", (info->score > 0) ? "won" : \
+                (info->score < 0) ? "lost" : "drawn", abs(info->score), 
+                info->depth, info->nodes, info->seconds, 
+                (info->seconds > 0) ? info->nodes / info->seconds : 0.0);
+    } else if ((playerType == AI_SEARCH) && !s->quiet) {
+        fprintf(stderr, "Search: depth %d score %d nodes %ld time %.3fs "
+                "(%.0f nodes/s, %d threads)\n", info->depth, info->score, 
+                info->nodes, info->seconds, (info->seconds > 0) ? \
+                info->nodes / info->seconds : 0.0, game->threads);
+        tt_report(game->tt);
+    } else if ((playerType == AI_MCTS) && !s->quiet) {
+        fprintf(stderr, "MCTS: playouts %ld win %d%% depth %d time %.3fs "
+                "(%.0f playouts/s, %d threads)\n", info->nodes, info->score, 
+                info->depth, info->seconds, (info->seconds > 0) ? \
+                info->nodes / info->seconds : 0.0, game->threads);
     }
     
-    /* Find an available position */
-    while (1) {
-        /* is this position a valid move? */
-        if ((game->validMove).s[x][y] == game->whoseTurn) {
-            break;
-        }
-        y += dy;
-        /* walked off ends of board - wrap around */
-        if ((y < 0)) {
-            y = size-1;
-            x--;
-        } else if (y >= size) {
-            y = 0;
-            x++;
-        }
-        /* walked off top/bottom of board - suspend; debug problem */
-        if ((x < 0) || (x >= size)) {
-            sysMessage(0, game);
+    /* Place tile, display & prepare for the next player */
+    record_move(pos, s);
+    game_put_tile(pos, game);
+    if (!s->quiet) {
+        frame_printf(s, "Player %c moves at %d %d.\n", game->whoseTurn, 
+                     x, y);
+        if (s->display == DISPLAY_DIFF) {
+            board_diff(s);
+        } else if (s->display == DISPLAY_BOARD) {
+            board_print(s);
         }
+        frame_flush(s);
     }
-    /* Place tile, display & prepare for the next player */
-    game_put_tile(x, y, game);
-    printf("Player %c moves at %d %d.\n", game->whoseTurn, x, y);
-    board_print(&game->board);
     game_next_player(game);
     game->passes = 0;
 }
 
 
+void bench (sessionType * s, int games) {
+    /*
+        Play AI games back to back from the starting position without 
+            any output, & report the speed & results
+    */
+    gameType * game = s->game, board;
+    sessionType headless = *s;
+    int i, moves = 0, winsO = 0, winsX = 0;
+    double start, seconds;
+    
+    /* searches in every game share the table, as moves in one game do */
+    if ((game->pTypeO == AI_SEARCH) || (game->pTypeX == AI_SEARCH)) {
+        game->tt = tt_new(game->ttMb);
+    }
+    /* play on a copy, so the start can be restored between games */
+    game_clone(&board, game);
+    headless.game = &board;
+    headless.quiet = 1;
+    start = search_clock();
+    for (i = 0; i < games; i++) {
+        game_copy(&board, game);
+        record_start(&headless);
+        while (turn_decision(&headless) == GAME_ON);
+        record_end(&headless);
+        moves += game->empties - board.empties;
+        winsO += (board.scoreO > board.scoreX);
+        winsX += (board.scoreX > board.scoreO);
+    }
+    seconds = search_clock() - start;
+    
+    printf("Bench: %d games of %dx%d in %.3fs: %.1f games/s, %.0f moves/s\n",
+           games, (game->board).n, (game->board).n, seconds, 
+           (seconds > 0) ? games / seconds : 0.0, 
+           (seconds > 0) ? moves / seconds : 0.0);
+    printf("X wins %d (%.1f%%), O wins %d (%.1f%%), draws %d (%.1f%%)\n",
+           winsX, 100.0 * winsX / games, winsO, 100.0 * winsO / games, 
+           games - winsO - winsX, 100.0 * (games - winsO - winsX) / games);
+    /* the copy kept its counters from game to game */
+    if (s->showStats) {
+        stats_report(&board);
+    }
+    deadline_report(&board);
+    game_free(&board);
+    if (s->record != NULL) {
+        fclose(s->record);
+    }
+    game_free(game);
+}
+
+void board_print (sessionType * s) {
+    /* 
+        Add a graphical board representation to the frame, as one block
+    */
+    boardType * board = &(s->game)->board;
+    int i, n = board->n;
+    char * line;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    /* every line is n+3 bytes: borders, cells & newline */
+    if (s->frameLen + (n + 2) * (n + 3) + 1 > s->frameSize) {
+        s->frameSize = s->frameLen + (n + 2) * (n + 3) + 1;
+        s->frame = (char *) realloc(s->frame, s->frameSize);
+    }
+    line = &s->frame[s->frameLen];
+    line[0] = '+';
+    memset(&line[1], '-', n);
+    line[n+1] = '+';
+    line[n+2] = '\n';
+    for (i = 0; i < n; i++) {
+        line += n + 3;
+        line[0] = '|';
+        memcpy(&line[1], &CELL(board, i, 0), n);
+        line[n+1] = '|';
+        line[n+2] = '\n';
+    }
+    memcpy(line + n + 3, &s->frame[s->frameLen], n + 3);
+    s->frameLen += (n + 2) * (n + 3);
+    STATS_STOP(s->game, STATS_RENDER, timer);
+}
+
+void board_diff (sessionType * s) {
+    /*
+        Add the cells changed by the last move to the frame, drawn in place
+            over the board printed by play (screen row & column are one 
+            more than the cell's, past the border)
+    */
+    gameType * game = s->game;
+    int i, pos, stride = (game->board).stride;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    frame_printf(s, "\0337");
+    for (i = 0; i < game->nChanged; i++) {
+        pos = (game->changed)[i];
+        frame_printf(s, "\033[%d;%dH%c", pos / stride + 1, 
+                     pos % stride + 1, (game->board).s[pos]);
+    }
+    frame_printf(s, "\0338");
+    STATS_STOP(game, STATS_RENDER, timer);
+}
+
+
 /* ------------------------------------------------------------------------- */
 
-/* Boardgame engine */
+/* Move generation tests */
 
-bool board_walk(int x, int y, int dx, int dy, char tile, \
-                boardType * board, int action) {
+void perft (gameType * game, int depth, int threads) {
     /*
-        Combination of actions when moving along path (dx,dy) on the board
-            WALK_VALIDATE:  Return if a valid path to another tile exists
-            WALK_REPLACE:   Flip the other players' tiles where possible
-                             (assumes path already validated)
+        Count the positions 'depth' moves on (a pass is a move, and a 
+            finished game is a position however deep), split by root move.
+            Threads take root moves one at a time, each with its own copy
+            of the game. Counts must match between engines.
     */
-    int i, j, enemy_pieces = 0;
+    perftSharedType shared;
+    perftType work[SEARCH_MAX_THREADS];
+    pthread_t helper[SEARCH_MAX_THREADS];
+    int i, x, y, n = (game->board).n;
+    long nodes = 0;
+    double start, seconds;
     
-    i = x;
-    j = y;  
-    /* Walk along board */
-    while (1) {
-        /* Move along the path! */
-        i += dx;
-        j += dy;
-        /* Exit condition: walked off board*/
-        if ((i < 0) || (j < 0) || (i >= board->n) || (j >= board->n)) {
-            /*printf("off board\n");*/
-            return 0;
+    start = search_clock();
+    shared.depth = depth;
+    shared.next = 0;
+    shared.nMoves = 0;
+    shared.moves = (int *) malloc(n * n * sizeof(int));
+    shared.counts = (long *) calloc(n * n, sizeof(long));
+    /* the root is split unless it is already a leaf */
+    if ((depth > 0) && (game->empties > 0)) {
+        shared.nMoves = game_list_moves(game);
+        memcpy(shared.moves, game->moveList, shared.nMoves * sizeof(int));
+        if ((shared.nMoves == 0) && (game->passes == 0)) {
+            shared.moves[shared.nMoves++] = -1;
         }
-        /* Exit condition: walked to empty cell */
-        else if ((board->s)[i][j] == '.') {
-            /*printf("empty cell\n");*/
-            return 0;
+    }
+    for (i = 0; i < threads; i++) {
+        work[i].shared = &shared;
+        work[i].moves = (int *) malloc((depth + 1) * n * n * sizeof(int));
+        if (i == 0) {
+            work[i].game = game;
+        } else {
+            work[i].game = (gameType *) malloc(sizeof(gameType));
+            game_clone(work[i].game, game);
+            pthread_create(&helper[i], NULL, perft_root_moves, &work[i]);
         }
-        /* Action: found enemy piece */
-        else if ((board->s)[i][j] != tile) {
-            /*printf("found enemy piece!\n");*/
-            enemy_pieces++;
-            if (action == WALK_REPLACE) {
-                (board->s)[i][j] = tile;
-            }
+    }
+    perft_root_moves(&work[0]);
+    for (i = 1; i < threads; i++) {
+        pthread_join(helper[i], NULL);
+    }
+    seconds = search_clock() - start;
+    
+    for (i = 0; i < shared.nMoves; i++) {
+        if (shared.moves[i] < 0) {
+            printf("pass: %ld\n", shared.counts[i]);
+        } else {
+            x = shared.moves[i] / (game->board).stride - 1;
+            y = shared.moves[i] % (game->board).stride - 1;
+            printf("%d %d: %ld\n", x, y, shared.counts[i]);
         }
-        /* Action: found player piece */
-        else if ((board->s)[i][j] == tile) {
-            /*printf("found friendly piece\n");*/
-            /* only if this is not the first iteration! */
-            
-            return enemy_pieces;
-            /* This works as a true/false expression, returning true if:
-                WALK_VALIDATE:  the path has enemy pieces and is valid
-                WALK_REPLACE:   replacements have been made */
+        nodes += shared.counts[i];
+    }
+    if (shared.nMoves == 0) {
+        nodes = 1;
+    }
+    printf("Perft %d: %ld nodes in %.3fs (%.0f nodes/s, engine %d, "
+           "%d threads)\n", depth, nodes, seconds, 
+           (seconds > 0) ? nodes / seconds : 0.0, game->engine, threads);
+    for (i = 0; i < threads; i++) {
+        free(work[i].moves);
+        if (i > 0) {
+            game_free(work[i].game);
+            free(work[i].game);
+        }
+    }
+    free(shared.moves);
+    free(shared.counts);
+    game_free(game);
+}
+
+void * perft_root_moves (void * arg) {
+    /*
+        Thread body: count under root moves handed out by the shared 
+            counter until none are left
+    */
+    perftType * perft = (perftType *) arg;
+    perftSharedType * shared = perft->shared;
+    int i;
+    
+    while ((i = __atomic_fetch_add(&shared->next, 1, __ATOMIC_RELAXED)) < \
+           shared->nMoves) {
+        if (shared->moves[i] < 0) {
+            game_make_pass(perft->game);
+        } else {
+            game_make_move(shared->moves[i], perft->game);
         }
+        shared->counts[i] = perft_count(perft->game, shared->depth - 1, \
+                                        perft->moves);
+        game_unmake_move(perft->game);
     }
+    return NULL;
 }
 
-bool move_valid (int x, int y, char tile, boardType * board) {
+long perft_count (gameType * game, int depth, int * moves) {
     /*
-        Return whether the position is a valid move for the given tile
-    */  
-    int i, dx, dy;
+        Count the positions 'depth' moves on from this one, using 'moves'
+            & beyond it for each ply's move list
+    */
+    int i, n;
+    long count = 0;
     
-    /* Exit if position is taken */
-    if ((board->s)[x][y] != '.') {
-        return 0;
+    if ((depth == 0) || (game->empties == 0)) {
+        return 1;
     }
-    /* Check for any links with same-player tiles to validate move */
-    for (i = 0; i < 8; i++) {
-        dx = vect[i][0];
-        dy = vect[i][1];
-        if (board_walk(x, y, dx, dy, tile, board, WALK_VALIDATE)) {
+    n = game_list_moves(game);
+    if (n == 0) {
+        /* the second pass in a row ends the game */
+        if (game->passes > 0) {
             return 1;
         }
+        game_make_pass(game);
+        count = perft_count(game, depth - 1, moves);
+        game_unmake_move(game);
+        return count;
     }
-    /* No linked tiles found */
-    return 0;
+    /* each move leads to exactly one position */
+    if (depth == 1) {
+        return n;
+    }
+    memcpy(moves, game->moveList, n * sizeof(int));
+    for (i = 0; i < n; i++) {
+        game_make_move(moves[i], game);
+        count += perft_count(game, depth - 1, moves + n);
+        game_unmake_move(game);
+    }
+    return count;
 }
 
-void game_update_valid_moves (gameType * game) {
+
+/* ------------------------------------------------------------------------- */
+
+/* Search tests */
+
+void check (gameType * game, int positions, int threads) {
     /*
-        Refresh the array of valid moves for the current player
+        Search random positions 1 ply deep, & report any where the move 
+            found scores less than the best move by evaluation. Every 
+            root move must be searched, on any number of threads.
     */
-    int i, j;
-    /* wipe old moves */
-    board_cleanup(&game->validMove);
-    /* loop over all board positions */
-    for (i  = 0; i < (game->validMove).n; i++) {
-        for (j = 0; j < (game->validMove).n; j++) {
-            /* write a character if position is a current valid move */
-            if (move_valid(i, j, game->whoseTurn, &game->board)) {
-                (game->validMove).s[i][j] = game->whoseTurn;
+    gameType board;
+    uint64_t random;
+    int i, n, job, plies, move, best, wrong = 0, skipped = 0;
+    int * moves = (int *) malloc(game->empties * sizeof(int));
+    
+    (game->limits).depth = 1;
+    (game->limits).timeMs = 0;
+    (game->limits).nodes = 0;
+    (game->limits).deadlineMs = 0;
+    game->endgame = 0;
+    game->threads = threads;
+    game->tt = tt_new(game->ttMb);
+    game_clone(&board, game);
+    for (job = 0; job < positions; job++) {
+        /* play a random number of random moves */
+        game_copy(&board, game);
+        random = ZOBRIST_SEED ^ (job + 1);
+        plies = job % game->empties;
+        while ((plies-- > 0) && (flip_status(&board) == GAME_ON)) {
+            n = game_list_moves(&board);
+            if (n == 0) {
+                flip_pass(&board);
+                continue;
+            }
+            random ^= random >> 12;
+            random ^= random << 25;
+            random ^= random >> 27;
+            i = ((random * 0x2545F4914F6CDD1DULL) >> 32) % n;
+            flip_move(&board, board.moveList[i] / board.board.stride - 1, 
+                      board.moveList[i] % board.board.stride - 1);
+        }
+        n = (flip_status(&board) == GAME_ON) ? game_list_moves(&board) : 0;
+        if (n == 0) {
+            skipped++;
+            continue;
+        }
+        memcpy(moves, board.moveList, n * sizeof(int));
+        
+        move = search_move(&board);
+        best = 0;
+        for (i = 1; i < n; i++) {
+            if (check_value(&board, moves[i]) > \
+                check_value(&board, moves[best])) {
+                best = i;
             }
         }
+        if (check_value(&board, move) < check_value(&board, moves[best])) {
+            printf("Position %d: searched %d %d scoring %d, but %d %d "
+                   "scores %d.\n", job, move / board.board.stride - 1, 
+                   move % board.board.stride - 1, check_value(&board, move),
+                   moves[best] / board.board.stride - 1, 
+                   moves[best] % board.board.stride - 1, 
+                   check_value(&board, moves[best]));
+            wrong++;
+        }
     }
+    
+    printf("Check: %d positions searched 1 ply on %d threads, %d wrong "
+           "(%d with no move skipped)\n", positions - skipped, threads,
+           wrong, skipped);
+    free(moves);
+    game_free(&board);
+    game_free(game);
 }
 
-void game_put_tile (int x, int y, gameType * game) {
+int check_value (gameType * game, int move) {
     /*
-        Execute a player's turn & place tiles appropriately
+        Score of a move 1 ply deep for the player making it, as the search
+            finds it: the evaluation of the position it leaves, looking 
+            past a pass, or the result if the game ends
     */
-    int i, dx, dy;
-    char tile;
+    int score;
     
-    /* Place centre tile */
-    tile = game->whoseTurn;
-    (game->board).s[x][y] = tile;
-    /* Replace tiles now bounded by this players' pieces */
-    for (i = 0; i < 8; i++) {
-        dx = vect[i][0];
-        dy = vect[i][1];
-        if (board_walk(x, y, dx, dy, tile, &game->board, WALK_VALIDATE)) {
-            board_walk(x, y, dx, dy, tile, &game->board, WALK_REPLACE);
-        }
+    game_make_move(move, game);
+    if (game->empties == 0) {
+        score = -search_final(game);
+    } else if (game_list_moves(game) > 0) {
+        score = -search_eval(game);
+    } else {
+        game_make_pass(game);
+        score = (game_list_moves(game) > 0) ? search_eval(game) : \
+                search_final(game);
+        game_unmake_move(game);
     }
+    game_unmake_move(game);
+    return score;
 }
 
 
 /* ------------------------------------------------------------------------- */
 
-/* Game state, memory management and R/W */
+/* Tournaments */
 
-void game_ini (gameType * game) {
-    /* 
-        Apply initial game state; board unchanged
-    */
-    game->scoreO = 0;
-    game->scoreX = 0;
-    game->pTypeO = -1;
-    game->pTypeX = -1;
-    game->whoseTurn = 'O';
-    game->filepath = (char *) malloc(sizeof(char));
-    game->filepath[0] = '\0';
-    game->passes = 0;
+void tournament (tournamentType * t, int threads) {
+    /*
+        Play every game of the tournament on a pool of threads, each 
+            taking the next game when it finishes one, & report
+    */
+    pthread_t worker[SEARCH_MAX_THREADS];
+    double start;
+    int i;
+    
+    t->next = 0;
+    t->results = (signed char *) malloc(t->nJobs * sizeof(signed char));
+    start = search_clock();
+    for (i = 1; i < threads; i++) {
+        pthread_create(&worker[i], NULL, tournament_games, t);
+    }
+    tournament_games(t);
+    for (i = 1; i < threads; i++) {
+        pthread_join(worker[i], NULL);
+    }
+    tournament_report(t, search_clock() - start, threads);
+    free(t->results);
 }
 
-void game_set_fname (char * fname, gameType *game) {
-    /* 
-        Set the referrable filepath for load, save & sysMessage
+void * tournament_games (void * arg) {
+    /*
+        Thread body: play games handed out by the shared counter until 
+            none are left. The thread keeps one game state per board size,
+            reset from a start position for each game.
     */
-    free(game->filepath);
-    game->filepath = (char *) malloc((strlen(fname)+1) * sizeof(char));
-    game->filepath[strlen(fname)] = '\0';
-    strcpy(game->filepath, fname);
+    tournamentType * t = (tournamentType *) arg;
+    gameType ** start, ** board;
+    int i, err, job;
+    
+    start = (gameType **) malloc(t->nDims * sizeof(gameType *));
+    board = (gameType **) malloc(t->nDims * sizeof(gameType *));
+    for (i = 0; i < t->nDims; i++) {
+        start[i] = flip_new(t->dims[i], &err);
+        /* this thread's searches share a table, as in one game */
+        start[i]->tt = tt_new(t->ttMb);
+        if (t->bookPath != NULL) {
+            book_close(start[i]->book);
+            start[i]->book = book_open(t->bookPath, t->dims[i]);
+        }
+        if (t->evalPath != NULL) {
+            eval_close(start[i]->eval);
+            start[i]->eval = eval_open(t->evalPath, &start[i]->board);
+            eval_reset(start[i]);
+        }
+        board[i] = (gameType *) malloc(sizeof(gameType));
+        game_clone(board[i], start[i]);
+    }
+    while ((job = __atomic_fetch_add(&t->next, 1, __ATOMIC_RELAXED)) < \
+           t->nJobs) {
+        i = (job / t->games) % t->nDims;
+        game_copy(board[i], start[i]);
+        t->results[job] = tournament_game(t, job, board[i]);
+    }
+    for (i = 0; i < t->nDims; i++) {
+        game_free(board[i]);
+        free(board[i]);
+        flip_destroy(start[i]);
+    }
+    free(start);
+    free(board);
+    return NULL;
 }
 
-void game_load (char * fname, gameType * game) {
+int tournament_game (tournamentType * t, int job, gameType * board) {
     /*
-        Try to load & apply a gamestate from the file
-            Assumes gameplay has not yet started
+        Play one game of the tournament from the start position on the 
+            board, after TOURNAMENT_RANDOM_PLIES random moves. The pair 
+            swap colours every game, & each two games share an opening.
+            Returns 1 if the pair's first player won, -1 if they lost or 
+            0 for a draw.
     */
-    FILE * f;
+    entrantType * a, * b, * mover;
+    uint64_t random;
+    int i, n, plies, scoreO, scoreX, swap;
+    int pair = job / (t->games * t->nDims);
+    
+    /* the opening: the same for every pairing, by the game's number */
+    random = ZOBRIST_SEED ^ ((job % t->games) / 2 + 1);
+    for (plies = 0; (plies < TOURNAMENT_RANDOM_PLIES) && \
+            (flip_status(board) == GAME_ON); plies++) {
+        n = game_list_moves(board);
+        if (n == 0) {
+            flip_pass(board);
+            continue;
+        }
+        random ^= random >> 12;
+        random ^= random << 25;
+        random ^= random >> 27;
+        i = ((random * 0x2545F4914F6CDD1DULL) >> 32) % n;
+        flip_move(board, board->moveList[i] / board->board.stride - 1, 
+                  board->moveList[i] % board->board.stride - 1);
+    }
+    
+    a = &t->players[t->pairA[pair]];
+    b = &t->players[t->pairB[pair]];
+    do {
+        /* a plays O (who moves first) in even games */
+        mover = ((board->whoseTurn == 'O') == ((job % t->games) % 2 == 0)) ? \
+                a : b;
+        board->limits = mover->limits;
+    } while (flip_ai_move(board, mover->type) == FLIP_OK);
+    flip_score(board, &scoreO, &scoreX);
+    if ((job % t->games) % 2) {
+        swap = scoreO;
+        scoreO = scoreX;
+        scoreX = swap;
+    }
+    return (scoreO > scoreX) - (scoreO < scoreX);
+}
+
+void tournament_report (tournamentType * t, double seconds, int threads) {
+    /*
+        Write the cross-table of each player's score against each other 
+            (wins plus half the draws, as a percentage), their win/draw/
+            loss totals & Elo rating relative to the field
+    */
+    int i, j, job, pair, a, b, n = t->nPlayers, games;
+    int * wins = (int *) calloc(n * n, sizeof(int));
+    int * draws = (int *) calloc(n * n, sizeof(int));
+    double score, p;
+    
+    for (job = 0; job < t->nJobs; job++) {
+        pair = job / (t->games * t->nDims);
+        a = t->pairA[pair];
+        b = t->pairB[pair];
+        if (t->results[job] > 0) {
+            wins[a*n + b]++;
+        } else if (t->results[job] < 0) {
+            wins[b*n + a]++;
+        } else {
+            draws[a*n + b]++;
+            draws[b*n + a]++;
+        }
+    }
+    games = t->games * t->nDims;
+    printf("%-8s", "");
+    for (j = 0; j < n; j++) {
+        printf(" %7.7s", t->players[j].name);
+    }
+    printf("    wins draws losses    Elo\n");
+    for (i = 0; i < n; i++) {
+        printf("%-8.8s", t->players[i].name);
+        a = 0;
+        b = 0;
+        for (j = 0; j < n; j++) {
+            if (i == j) {
+                printf(" %7s", "-");
+                continue;
+            }
+            printf(" %6.1f%%", 100.0 * (wins[i*n + j] + draws[i*n + j] / 2.0) \
+                               / games);
+            a += wins[i*n + j];
+            b += draws[i*n + j];
+        }
+        /* Elo from the score against the field, kept off 0% & 100% */
+        score = a + b / 2.0;
+        p = score / (games * (n-1));
+        if (p < 0.5 / (games * (n-1))) {
+            p = 0.5 / (games * (n-1));
+        } else if (p > 1 - 0.5 / (games * (n-1))) {
+            p = 1 - 0.5 / (games * (n-1));
+        }
+        printf(" %7d %5d %6d %+6.0f\n", a, b, games * (n-1) - a - b, 
+               400 * log10(p / (1-p)));
+    }
+    printf("Tournament: %d games in %.3fs (%.1f games/s, %d threads)\n", 
+           t->nJobs, seconds, (seconds > 0) ? t->nJobs / seconds : 0.0, 
+           threads);
+    free(wins);
+    free(draws);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Training */
+
+void train (trainType * t, int threads) {
+    /*
+        Fit the evaluation weights to self-play: 'threads' threads play 
+            games into the ring buffer while as many others fit the 
+            weights to what comes out, then write the weight file
+    */
+    pthread_t player[SEARCH_MAX_THREADS], fitter[SEARCH_MAX_THREADS];
+    double start, seconds;
     int i;
-    char validator[5] = {'\0'};
-    game_set_fname(fname, game);
     
-    /* Check file readable */
-    if (strlen(fname) == 0) {
-        sysMessage(7, game); 
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->notEmpty, NULL);
+    pthread_cond_init(&t->notFull, NULL);
+    t->ring = (trainSampleType *) malloc(TRAIN_RING * sizeof(trainSampleType));
+    t->head = 0;
+    t->count = 0;
+    t->next = 0;
+    t->playing = threads;
+    t->samples = 0;
+    t->windowSamples = 0;
+    t->windowError = 0;
+    t->lastError = -1;
+    start = search_clock();
+    for (i = 0; i < threads; i++) {
+        pthread_create(&player[i], NULL, train_games, t);
+        pthread_create(&fitter[i], NULL, train_fit, t);
     }
-    f = fopen(fname, "r");
-    if (f == NULL) {
-        sysMessage(7, game);
+    for (i = 0; i < threads; i++) {
+        pthread_join(player[i], NULL);
+        pthread_join(fitter[i], NULL);
     }
-    /* Simple 'file-is-a-flip-save-file' check */
-    fread(validator, 1, sizeof(char) * strlen(PROG_NAME), f);
-    if ((strcmp(validator, PROG_NAME))) {
-        sysMessage(7, game);
+    seconds = search_clock() - start;
+    
+    printf("Train: %d games of %dx%d, %ld positions in %.3fs "
+           "(%.0f positions/s, %d+%d threads)\n", t->games, t->dim, t->dim,
+           t->samples, seconds, (seconds > 0) ? t->samples / seconds : 0.0,
+           threads, threads);
+    printf("Error: %.2f discs rms over the last %ld positions\n", 
+           sqrt(((t->lastError >= 0) ? t->lastError : t->windowError) / \
+                ((t->lastError >= 0) ? TRAIN_RING : \
+                 (t->windowSamples ? t->windowSamples : 1))), 
+           (t->lastError >= 0) ? (long) TRAIN_RING : t->windowSamples);
+    free(t->ring);
+    pthread_cond_destroy(&t->notEmpty);
+    pthread_cond_destroy(&t->notFull);
+    pthread_mutex_destroy(&t->lock);
+}
+
+void * train_games (void * arg) {
+    /*
+        Thread body: play self-play games handed out by the shared counter,
+            each opening with random moves for variety, & put every 
+            position into the ring labelled with the final disc margin
+    */
+    trainType * t = (trainType *) arg;
+    trainSampleType * game_samples;
+    gameType * start, board;
+    uint64_t random;
+    int i, n, err, job, count, margin, cells = t->dim * t->dim;
+    
+    start = flip_new(t->dim, &err);
+    start->limits = t->limits;
+    start->tt = tt_new(t->ttMb);
+    if (t->evalPath != NULL) {
+        eval_close(start->eval);
+        start->eval = eval_open(t->evalPath, &start->board);
+        eval_reset(start);
     }
+    game_clone(&board, start);
+    game_samples = (trainSampleType *) malloc(cells * sizeof(trainSampleType));
     
-    /* Read new data */
-    fread(&game->passes, 1, sizeof(int), f);
-    fread(&game->pTypeO, 1, sizeof(int), f);
-    fread(&game->pTypeX, 1, sizeof(int), f);
-    fread(&game->whoseTurn, 1, sizeof(char), f);
-    fread(&(game->board).n, 1, sizeof(int), f);
-    /* board/validMove state */
-    (game->validMove).n = (game->board).n;
-    board_ini(&game->board, (game->board).n);
-    board_ini(&game->validMove, (game->validMove).n);
-    for (i = 0; i < (game->board).n; i++) {
-        fread((game->board).s[i], 1, sizeof(char) * (game->board).n, f);
+    while ((job = __atomic_fetch_add(&t->next, 1, __ATOMIC_RELAXED)) < \
+           t->games) {
+        game_copy(&board, start);
+        random = ZOBRIST_SEED ^ (job + 1);
+        count = 0;
+        /* passes alone can't tell a wiped out player's game is over */
+        while (flip_status(&board) == GAME_ON) {
+            n = game_list_moves(&board);
+            if (n == 0) {
+                flip_pass(&board);
+                continue;
+            }
+            /* the position, as eval_score sees it */
+            memcpy(game_samples[count].index, board.evalIndex, 
+                   sizeof(board.evalIndex));
+            game_samples[count].margin = board.scoreO - board.scoreX;
+            game_samples[count].moves = n;
+            game_samples[count].sign = (board.whoseTurn == 'O') ? 1 : -1;
+            count++;
+            if (cells - board.empties < TRAIN_RANDOM_PLIES + 4) {
+                random ^= random >> 12;
+                random ^= random << 25;
+                random ^= random >> 27;
+                i = ((random * 0x2545F4914F6CDD1DULL) >> 32) % n;
+                flip_move(&board, board.moveList[i] / board.board.stride - 1, 
+                          board.moveList[i] % board.board.stride - 1);
+            } else {
+                flip_ai_move(&board, AI_SEARCH);
+            }
+        }
+        margin = board.scoreO - board.scoreX;
+        
+        /* hand the game over, waiting for room as needed */
+        pthread_mutex_lock(&t->lock);
+        for (i = 0; i < count; i++) {
+            while (t->count == TRAIN_RING) {
+                pthread_cond_wait(&t->notFull, &t->lock);
+            }
+            game_samples[i].label = margin;
+            t->ring[(t->head + t->count) % TRAIN_RING] = game_samples[i];
+            t->count++;
+            pthread_cond_signal(&t->notEmpty);
+        }
+        pthread_mutex_unlock(&t->lock);
     }
-    fclose(f);
+    
+    pthread_mutex_lock(&t->lock);
+    t->playing--;
+    pthread_cond_broadcast(&t->notEmpty);
+    pthread_mutex_unlock(&t->lock);
+    free(game_samples);
+    game_free(&board);
+    flip_destroy(start);
+    return NULL;
 }
 
-void game_save (char * fname, gameType * game) {
-/*
-    Try to write state-dependent parts of '*game' to file
- 
-    'flip'
-    passes
-    pType1
-    pType2
-    whoseTurn
-    board.n
-    board.s[0]
-    ...
-    board.s[n-1]
-*/
-    FILE * f;
-    int i;
-    char * validator = PROG_NAME;
-    game_set_fname(fname, game);
+void * train_fit (void * arg) {
+    /*
+        Thread body: take positions from the ring a batch at a time & move
+            the weights down the squared error's gradient. Threads update
+            the shared weights without locking; a lost update now & then
+            costs less than the lock would.
+    */
+    trainType * t = (trainType *) arg;
+    trainSampleType batch[TRAIN_BATCH];
+    trainSampleType * s;
+    float * w = t->weights, error, step;
+    double sumError;
+    int i, k, n, mobility;
+    
+    while (1) {
+        pthread_mutex_lock(&t->lock);
+        while ((t->count == 0) && (t->playing > 0)) {
+            pthread_cond_wait(&t->notEmpty, &t->lock);
+        }
+        if (t->count == 0) {
+            pthread_mutex_unlock(&t->lock);
+            break;
+        }
+        for (n = 0; (n < TRAIN_BATCH) && (t->count > 0); n++) {
+            batch[n] = t->ring[t->head];
+            t->head = (t->head + 1) % TRAIN_RING;
+            t->count--;
+        }
+        pthread_cond_broadcast(&t->notFull);
+        pthread_mutex_unlock(&t->lock);
+        
+        /* the prediction is eval_score's, from O's side, before scaling */
+        sumError = 0;
+        for (i = 0; i < n; i++) {
+            s = &batch[i];
+            mobility = EVAL_MOBILITY + ((s->moves < EVAL_MOVES) ? \
+                                        s->moves : EVAL_MOVES - 1);
+            error = (float) s->margin * EVAL_SCALE + s->sign * w[mobility];
+            for (k = 0; k < EVAL_PATTERNS; k++) {
+                error += w[s->index[k]];
+            }
+            error = (float) s->label * EVAL_SCALE - error;
+            sumError += (double) error * error / (EVAL_SCALE * EVAL_SCALE);
+            step = TRAIN_RATE * error;
+            for (k = 0; k < EVAL_PATTERNS; k++) {
+                w[s->index[k]] += step;
+            }
+            w[mobility] += s->sign * step;
+        }
+        
+        pthread_mutex_lock(&t->lock);
+        t->samples += n;
+        t->windowSamples += n;
+        t->windowError += sumError;
+        if (t->windowSamples >= TRAIN_RING) {
+            t->lastError = t->windowError * TRAIN_RING / t->windowSamples;
+            t->windowSamples = 0;
+            t->windowError = 0;
+        }
+        pthread_mutex_unlock(&t->lock);
+    }
+    return NULL;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Pondering */
+
+void ponder_start (ponderType * p, sessionType * s) {
+    /*
+        With --ponder, search ahead in the background while the player to
+            move thinks, if the AI playing next can use the work: an 
+            alpha-beta player short of its endgame solver, which keeps no 
+            table. Not worth starting if their move is already waiting in
+            the input.
+    */
+    gameType * game = s->game;
+    int opponent = (game->whoseTurn == 'O') ? game->pTypeX : game->pTypeO;
     
-    /* Check file writable */
-    if (strlen(fname) == 0) {
-        sysMessage(9, game);
+    p->running = 0;
+    if (!s->ponder || (opponent != AI_SEARCH) || \
+        (game->empties - 1 <= game->endgame) || \
+        ((s->input != NULL) && (memchr(&s->input[s->inputAt], '\n',
+                                s->inputLen - s->inputAt) != NULL))) {
         return;
     }
-    f = fopen(fname, "w");
-    if (f == NULL) {
-        sysMessage(8, game);
+    /* the copy has to share the game's table */
+    if (game->tt == NULL) {
+        game->tt = tt_new(game->ttMb);
+    }
+    game_clone(&p->game, game);
+    p->reply = (game->lastSearch).reply;
+    if ((p->reply >= 0) && game_move_legal(p->reply, game)) {
+        /* the AI's own search of the expected position, with no clock */
+        game_put_tile(p->reply, &p->game);
+        game_next_player(&p->game);
+        (p->game).passes = 0;
+        if (game_list_moves(&p->game) == 0) {
+            game_free(&p->game);
+            return;
+        }
+        (p->game).limits.depth = (game->limits).depth;
+    } else {
+        /* every reply, to the full depth the AI will want */
+        p->reply = -1;
+        (p->game).limits.depth = ((game->limits).depth > 0) ? \
+                                 (game->limits).depth + 1 : 0;
+    }
+    (p->game).limits.timeMs = 0;
+    (p->game).limits.nodes = 0;
+    (p->game).limits.deadlineMs = 0;
+    (p->game).ponderHash = 0;
+    p->abort = 0;
+    (p->game).abort = &p->abort;
+    p->running = 1;
+    pthread_create(&p->thread, NULL, ponder_search, p);
+}
+
+void ponder_stop (ponderType * p, sessionType * s) {
+    /*
+        End a background search from ponder_start, if any, & report how 
+            far it got. The expected position's search time is kept, to 
+            count against the AI's search should the guess be right.
+    */
+    gameType * game = s->game;
+    searchInfoType * info = &(p->game).lastSearch;
+    
+    if (!p->running) {
         return;
     }
-    /*Write validation code, variables & board array*/
-    fwrite(validator, 1, sizeof(char) * strlen(PROG_NAME), f);
-    fwrite(&game->passes, 1, sizeof(int), f);
-    fwrite(&game->pTypeO, 1, sizeof(int), f);
-    fwrite(&game->pTypeX, 1, sizeof(int), f);
-    fwrite(&game->whoseTurn, 1, sizeof(char), f);
-    fwrite(&(game->board).n, 1, sizeof(int), f);
-    for (i = 0; i < (game->board).n; i++) {
-        fwrite((game->board).s[i], 1, sizeof(char) * (game->board).n, f);
+    __atomic_store_n(&p->abort, 1, __ATOMIC_RELAXED);
+    pthread_join(p->thread, NULL);
+    p->running = 0;
+    /* pondered again after a bad line of input: the time adds up */
+    if ((p->reply >= 0) && (game->ponderHash == (p->game).hash)) {
+        game->ponderSeconds += info->seconds;
+    } else if (p->reply >= 0) {
+        game->ponderHash = (p->game).hash;
+        game->ponderSeconds = info->seconds;
+    }
+    if (!s->quiet && (s->display != DISPLAY_MOVES)) {
+        if (p->reply >= 0) {
+            fprintf(stderr, "Ponder: expecting %d %d, ", 
+                    p->reply / (game->board).stride - 1, 
+                    p->reply % (game->board).stride - 1);
+        } else {
+            fprintf(stderr, "Ponder: every reply, ");
+        }
+        fprintf(stderr, "depth %d nodes %ld time %.3fs\n", info->depth, 
+                info->nodes, info->seconds);
     }
-    fclose(f);
-    sysMessage(4, game);
+    game_free(&p->game);
 }
 
-void game_next_player (gameType * game) {
+void * ponder_search (void * arg) {
     /*
-        Swap players
+        Thread body: search the copied position until it is done or told
+            to stop
     */
-    if (game->whoseTurn == 'X') {
-        game->whoseTurn = 'O';
-    } else {
-        game->whoseTurn = 'X';
-    }   
+    ponderType * p = (ponderType *) arg;
+    
+    search_move(&p->game);
+    return NULL;
 }
 
-void game_update_scoring (gameType * game) {
-    /* 
-        Read the score into the game struct
-    */
-    int i, j;
-    game->scoreO = 0;
-    game->scoreX = 0;
-    /* Loop over board */
-    for (i = 0; i < (game->board).n; i++) {
-        for (j = 0; j < (game->board).n; j++) {
-            /* Increment player 1/2 score */
-            switch ( (game->board).s[i][j] ) {
-                case 'O':
-                    game->scoreO++;
-                    break;
-                case 'X':
-                    game->scoreX++;
-                    break;
-            }
+
+/* ------------------------------------------------------------------------- */
+
+/* Output */
+
+void frame_printf (sessionType * s, const char * format, ...) {
+    /*
+        Add formatted text to the frame for this turn, growing it if needed
+    */
+    va_list args;
+    int len;
+    
+    va_start(args, format);
+    len = vsnprintf(&s->frame[s->frameLen], 
+                    s->frameSize - s->frameLen, format, args);
+    va_end(args);
+    if (s->frameLen + len >= s->frameSize) {
+        s->frameSize = 2 * (s->frameLen + len + 1);
+        s->frame = (char *) realloc(s->frame, s->frameSize);
+        va_start(args, format);
+        vsnprintf(&s->frame[s->frameLen], 
+                  s->frameSize - s->frameLen, format, args);
+        va_end(args);
+    }
+    s->frameLen += len;
+}
+
+void frame_flush (sessionType * s) {
+    /*
+        Write the frame to stdout in one go, after anything printed before
+    */
+    int done = 0, len;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    fflush(stdout);
+    while (done < s->frameLen) {
+        len = write(STDOUT_FILENO, &s->frame[done], s->frameLen - done);
+        if (len <= 0) {
+            break;
         }
+        done += len;
     }
+    s->frameLen = 0;
+    STATS_STOP(s->game, STATS_RENDER, timer);
 }
 
-void board_ini (boardType * board, unsigned int size) {
-    /* 
-        Allocate memory for the board & write default values
-    */
-    int i, midPos;
-    board->n = size;
-    /* 2d string array */
-    board->s = (char **) malloc( (board->n) * sizeof(char *) );
-    for (i = 0; i < size; i++) {
-         /* allocate/write each line */
-        board->s[i] = (char *) malloc( (size+1) * sizeof(char) );
-        memset( board->s[i], '.', (size) * sizeof(char) );
-        board->s[i][size] = '\0';
-    }
-    /* fill in border string */
-    board->border = (char*) malloc( (size+1) * sizeof(char) );
-    memset( board->border, '-', (size) * sizeof(char) );
-    board->border[size] = '\0';
-    /* put starting positions on the board */
-    midPos = (board->n - 1)/2;
-    board->s[midPos][midPos] = 'O';
-    board->s[midPos+1][midPos] = 'X';
-    board->s[midPos][midPos+1] = 'X';
-    board->s[midPos+1][midPos+1] = 'O';
-    return;
-}
-
-void board_cleanup (boardType * board) {
-    /*
-        Writes '.' characters to the entire board
+void frame_end (sessionType * s) {
+    /*
+        Give the whole screen back to the text after a diff display
     */
-    int i;
-    for (i = 0; i < (board->n); i++) {
-        memset( board->s[i], '.', (board->n) * sizeof(char) );
+    if ((s->display == DISPLAY_DIFF) && (s->frame != NULL)) {
+        frame_printf(s, "\0337\033[r\0338");
+        frame_flush(s);
     }
 }
 
-void board_print (boardType * board) {
+
+void stats_report (gameType * game) {
+    /*
+        Write the profiling counters to stderr, as a table & as one line 
+            of JSON
+    */
+#ifdef FLIP_STATS
+    const char * rows[STATS_ROWS] = \
+        { "movegen", "put_tile", "score", "render", "input", "list_moves" };
+    statsType * stats = &game->stats;
     int i;
-    /* 
-        Write graphical board representation to stdout
+    
+    fflush(stdout);
+    fprintf(stderr, "%-10s %12s %16s %12s\n", "Stats", "calls", "cycles", 
+            "cycles/call");
+    for (i = 0; i < STATS_ROWS; i++) {
+        fprintf(stderr, "%-10s %12ld %16llu %12.1f\n", rows[i], 
+                stats->calls[i], (unsigned long long) stats->cycles[i], 
+                stats->calls[i] ? (double) stats->cycles[i] / \
+                stats->calls[i] : 0.0);
+    }
+    fprintf(stderr, "Search: nodes %ld, cutoffs %ld, tt probes %ld, "
+            "hits %ld (%.1f%%)\n", stats->nodes, stats->cutoffs, 
+            stats->ttProbes, stats->ttHits, stats->ttProbes ? \
+            100.0 * stats->ttHits / stats->ttProbes : 0.0);
+    fprintf(stderr, "{");
+    for (i = 0; i < STATS_ROWS; i++) {
+        fprintf(stderr, "\"%s\": {\"calls\": %ld, \"cycles\": %llu}, ", 
+                rows[i], stats->calls[i], 
+                (unsigned long long) stats->cycles[i]);
+    }
+    fprintf(stderr, "\"search\": {\"nodes\": %ld, \"cutoffs\": %ld, "
+            "\"ttProbes\": %ld, \"ttHits\": %ld}}\n", stats->nodes, 
+            stats->cutoffs, stats->ttProbes, stats->ttHits);
+#else
+    (void) game;
+    fprintf(stderr, "Stats: not built in; compile with -DFLIP_STATS\n");
+#endif
+}
+
+void deadline_report (gameType * game) {
+    /*
+        Write how the search AI's moves went against the deadline to 
+            stderr: percentiles of their times (to the percent of the 
+            deadline above), the worst, & how many came close
     */
-    printf("+%s+\n", board->border);
-    for (i = 0; i < (board->n); i++) {
-        printf("|%s|\n", board->s[i]);
+    deadlineStatsType * stats = &game->deadline;
+    int i, bucket, percentiles[3] = { 50, 90, 99 };
+    long count;
+    
+    if (((game->limits).deadlineMs <= 0) || (stats->moves == 0)) {
+        return;
     }
-    printf("+%s+\n", board->border);
+    fflush(stdout);
+    fprintf(stderr, "Deadline %ldms: %ld moves,", (game->limits).deadlineMs,
+            stats->moves);
+    for (i = 0; i < 3; i++) {
+        count = stats->histogram[0];
+        for (bucket = 0; count * 100 < stats->moves * percentiles[i]; ) {
+            count += stats->histogram[++bucket];
+        }
+        if (bucket == DEADLINE_BUCKETS - 1) {
+            fprintf(stderr, " p%d over", percentiles[i]);
+        } else {
+            fprintf(stderr, " p%d %d%%", percentiles[i], bucket + 1);
+        }
+    }
+    fprintf(stderr, ", worst %.1fms; %ld close (%.0f%%+), %ld cut off, "
+            "%ld over\n", stats->worst * 1000, stats->close, 
+            DEADLINE_CLOSE * 100, stats->cutOff, stats->over);
 }
 
-bool board_missing_char (char c, boardType * board) {
+
+/* ------------------------------------------------------------------------- */
+
+/* Game records */
+
+void record_start (sessionType * s) {
     /*
-        Return whether there are no free spots remaining
+        Begin a game in the record, if one is being written
     */
-    int i, j;
-    for (i = 0; i < (board->n); i++) {
-        for (j = 0; j < (board->n); j++) {
-            if ((board->s)[i][j] == c) {
-                return 0;
+    if (s->record != NULL) {
+        record_varint(((s->game)->board).n, s->record);
+    }
+}
+
+void record_move (int pos, sessionType * s) {
+    /*
+        Add a move (or a pass, pos -1) to the record
+    */
+    boardType * board = &(s->game)->board;
+    
+    if (s->record == NULL) {
+        return;
+    }
+    if (pos < 0) {
+        record_varint(RECORD_PASS, s->record);
+    } else {
+        record_varint((pos / board->stride - 1) * board->n + \
+                      pos % board->stride - 1 + 2, s->record);
+    }
+}
+
+void record_end (sessionType * s) {
+    /*
+        Finish the game in the record, & get it to the file
+    */
+    if (s->record != NULL) {
+        record_varint(RECORD_END, s->record);
+        fflush(s->record);
+    }
+}
+
+void record_varint (unsigned long value, FILE * f) {
+    /*
+        Write a value 7 bits at a time, low bits first
+    */
+    while (value >= 0x80) {
+        putc((value & 0x7F) | 0x80, f);
+        value >>= 7;
+    }
+    putc(value, f);
+}
+
+void replay (replayType * log) {
+    /*
+        Play through every game in a record, checking each move is valid,
+            & report the results. Uses one game state, remade only when 
+            the board size changes.
+    */
+    gameType * start = NULL, board;
+    unsigned long code, badCode = 0, dim = 0;
+    long games = 0, moves = 0, bad = 0, unfinished = 0;
+    long winsO = 0, winsX = 0, draws = 0, discsO = 0, discsX = 0;
+    int err, n, pos, turn, badTurn = 0;
+    bool legal, more;
+    double begin = search_clock(), seconds;
+    
+    while (replay_varint(log, &code)) {
+        games++;
+        /* a new board size needs a new game state */
+        if ((code <= 3) || (code > BOARD_MAX_DIM)) {
+            printf("Game %ld: invalid board size %lu.\n", games, code);
+            bad++;
+            break;
+        }
+        if (code != dim) {
+            if (start != NULL) {
+                game_free(&board);
+                flip_destroy(start);
             }
+            dim = code;
+            start = flip_new(dim, &err);
+            game_clone(&board, start);
         }
+        game_copy(&board, start);
+        n = dim;
+        
+        /* each turn: a valid move, or a pass with none available */
+        legal = 1;
+        for (turn = 1; (more = replay_varint(log, &code)) && \
+                (code != RECORD_END); turn++) {
+            if (!legal) {
+                continue;
+            }
+            if (code == RECORD_PASS) {
+                legal = (game_list_moves(&board) == 0) && (board.passes < 2);
+            } else {
+                pos = (code - 2 < n * n) ? \
+                  BOARD_POS(&board.board, (code - 2) / n, (code - 2) % n) : 0;
+                legal = (code - 2 < n * n) && game_move_legal(pos, &board);
+            }
+            if (!legal) {
+                badCode = code;
+                badTurn = turn;
+            } else if (code == RECORD_PASS) {
+                game_next_player(&board);
+                board.passes++;
+            } else {
+                game_put_tile(pos, &board);
+                game_next_player(&board);
+                board.passes = 0;
+                moves++;
+            }
+        }
+        if (!more) {
+            printf("Game %ld: record ends mid-game.\n", games);
+            unfinished++;
+            break;
+        }
+        if (!legal) {
+            printf("Game %ld: invalid move %lu at turn %d.\n", games, badCode, 
+                   badTurn);
+            bad++;
+            continue;
+        }
+        /* left before the end: no result to count */
+        if (flip_status(&board) == GAME_ON) {
+            unfinished++;
+            continue;
+        }
+        winsO += (board.scoreO > board.scoreX);
+        winsX += (board.scoreX > board.scoreO);
+        draws += (board.scoreX == board.scoreO);
+        discsO += board.scoreO;
+        discsX += board.scoreX;
+    }
+    seconds = search_clock() - begin;
+    
+    printf("Replay: %ld games, %ld moves in %.3fs (%.0f moves/s)\n", games, 
+           moves, seconds, (seconds > 0) ? moves / seconds : 0.0);
+    printf("Invalid %ld, unfinished %ld; O wins %ld, X wins %ld, draws %ld; "
+           "discs O=%ld X=%ld\n", bad, unfinished, winsO, winsX, 
+           draws, discsO, discsX);
+    if (start != NULL) {
+        game_free(&board);
+        flip_destroy(start);
     }
-    return 1;
 }
 
-void board_free (boardType * board) {
-    /* 
-     Clear memory used by board 
-     */
-    int i;
-    for (i = 0; i < (board->n); i++) {
-        free(board->s[i]);
-    }
-    free(board->s);
+bool replay_varint (replayType * log, unsigned long * value) {
+    /*
+        Read the next value from the record; returns 0 at the end of it
+    */
+    int shift = 0;
+    unsigned char byte;
+    
+    *value = 0;
+    do {
+        if (log->at == log->len) {
+            log->len = fread(log->buf, 1, REPLAY_BUFFER, log->f);
+            log->at = 0;
+            if (log->len == 0) {
+                return 0;
+            }
+        }
+        byte = log->buf[(log->at)++];
+        *value |= (unsigned long) (byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && (shift < 64));
+    return 1;
 }
 
 
@@ -841,19 +2302,6 @@ bool string_is_numeric (char * s) {
     return 1;
 }
 
-int string_find (char * s, char c) {
-	/*
-		Return the first position of c in the string, or -1
-	*/
-	int i;
-	for (i = 0; i < strlen(s); i++) {
-		if (s[i] == c) {
-			return i;
-		}
-	}
-	return -1;
-}
-
 void string_strip_nondigit (char * s) {
 	/*
 		Replace the first nondigit character with a string terminator
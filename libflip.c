@@ -0,0 +1,3516 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "libflip_private.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WIDE_X86 1
+#endif
+
+/* (x,y) movement vectors for all 8 paths from a tile, as bitboard shifts 
+    for 8x8, and the columns a shift may land on without wrapping around 
+    from the other edge */
+const int bbShift[8] = { -9, -8, -7, -1, 1, 7, 8, 9 };
+const uint64_t bbWrap[8] = { 
+    0x7F7F7F7F7F7F7F7FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFEFEFEFEFEFEFEFEULL,
+    0x7F7F7F7F7F7F7F7FULL, 0xFEFEFEFEFEFEFEFEULL, 0x7F7F7F7F7F7F7F7FULL,
+    0xFFFFFFFFFFFFFFFFULL, 0xFEFEFEFEFEFEFEFEULL };
+
+/* Multi-word shift kernel, chosen for the CPU by wb_kernel_ini */
+void (*wb_shift_and) (uint64_t * dst, const uint64_t * src, int shift, \
+                      const uint64_t * and, int words) = NULL;
+pthread_once_t wbKernelOnce = PTHREAD_ONCE_INIT;
+
+/* Pattern summing kernel, chosen for the CPU by eval_kernel_pick */
+int (*eval_sum) (const int32_t * index, const int16_t * weights) = NULL;
+pthread_once_t evalKernelOnce = PTHREAD_ONCE_INIT;
+
+/* ------------------------------------------------------------------------- */
+
+/* AI players & search */
+
+int ai_choose (int playerType, gameType * game) {
+    /*
+        Return the cell the AI type would play at. The search AI plays 
+            from the opening book while the position is in it, & keeps 
+            track of its times against any deadline.
+    */
+    int pos;
+    double start;
+    
+    if (playerType == AI_SEARCH) {
+        start = search_clock();
+        pos = book_move(game);
+        if (pos < 0) {
+            pos = search_move(game);
+        }
+        if ((game->limits).deadlineMs > 0) {
+            search_deadline_record(game, search_clock() - start);
+        }
+        return pos;
+    }
+    if (playerType == AI_MCTS) {
+        return mcts_move(game);
+    }
+    return ai_scan(playerType, game);
+}
+
+int ai_scan (int playerType, gameType * game) {
+    /*
+        Parse through the valid moves in the AI type's order & return the
+            first one found, or -1 if there are none
+     */
+    int x, y, dy, size;
+    size = (game->validMove).n;
+    
+    /* Choose an AI search pattern */
+    if (playerType == AI_FORWARD) {
+        x = 0;
+        y = 0;
+        dy = 1;
+    } else {
+        x = size-1;
+        y = size-1;
+        dy = -1;
+    }
+    
+    /* Find an available position */
+    while (1) {
+        /* is this position a valid move? */
+        if (CELL(&game->validMove, x, y) == game->whoseTurn) {
+            break;
+        }
+        y += dy;
+        /* walked off ends of board - wrap around */
+        if ((y < 0)) {
+            y = size-1;
+            x--;
+        } else if (y >= size) {
+            y = 0;
+            x++;
+        }
+        /* walked off top/bottom of board: no valid moves */
+        if ((x < 0) || (x >= size)) {
+            return -1;
+        }
+    }
+    return BOARD_POS(&game->board, x, y);
+}
+
+int search_move (gameType * game) {
+    /*
+        Iterative deepening negamax search within the game's limits, on 
+            game->threads threads sharing the transposition table.
+            Returns the best move of the deepest completed iteration, or
+            one the iteration cut off proved better, and records the 
+            search in game->lastSearch. Near the end of the game, the 
+            endgame solver takes over. With a deadline, the solver only 
+            gets the soft share of it, & the search is cut off at the 
+            hard limit, leaving the rest of the deadline to hand back the
+            move.
+    */
+    searchType * search[SEARCH_MAX_THREADS];
+    searchSharedType shared;
+    int i, depth, maxDepth, score, move, best = -1, bestScore = 0, done = 0;
+    long nodes = 0;
+    double now, seconds, pondered = 0, soft = 0, hard = 0, iteration;
+    double growth, last = 0;
+    
+    now = search_clock();
+    if ((game->limits).deadlineMs > 0) {
+        soft = now + search_soft_share(game) * (game->limits).deadlineMs / 1e3;
+        hard = now + DEADLINE_HARD * (game->limits).deadlineMs / 1e3;
+    }
+    if (game->empties <= game->endgame) {
+        move = solve_move(game, soft);
+        if (move >= 0) {
+            return move;
+        }
+        /* not solved in time: search with what's left */
+    }
+    if (game->tt == NULL) {
+        game->tt = tt_new(game->ttMb);
+    }
+    tt_new_search(game->tt);
+    memset(&shared, 0, sizeof(searchSharedType));
+    pthread_mutex_init(&shared.lock, NULL);
+    shared.limits = game->limits;
+    shared.abort = game->abort;
+    shared.start = now;
+    shared.soft = soft;
+    shared.hard = hard;
+    /* time already spent here by pondering comes off the clock */
+    if ((game->ponderHash != 0) && (game->hash == game->ponderHash)) {
+        pondered = game->ponderSeconds;
+        shared.start -= pondered;
+    }
+    game->ponderHash = 0;
+    shared.moves = (int *) malloc(game->nMoves * sizeof(int));
+    /* thread 0 searches the game itself, the others private copies */
+    for (i = 0; i < game->threads; i++) {
+        search[i] = (searchType *) calloc(1, sizeof(searchType));
+        search[i]->shared = &shared;
+        search[i]->id = i;
+        if (i == 0) {
+            search[i]->game = game;
+        } else {
+            search[i]->game = (gameType *) malloc(sizeof(gameType));
+            game_clone(search[i]->game, game);
+        }
+        search[i]->movesCapacity = (game->board).n * (game->board).n;
+        search[i]->moves = (int *) malloc(search[i]->movesCapacity * \
+                                          sizeof(int));
+        /* against the clock, the first check measures the node rate */
+        (search[i]->check).nodes = ((shared.limits).timeMs > 0 || \
+                                    hard > 0) ? 1 : SEARCH_CHECK_NODES;
+        (search[i]->check).at = (search[i]->check).nodes;
+        (search[i]->check).last = now;
+    }
+    /* no use looking past the end of the game */
+    maxDepth = game->empties;
+    if ((shared.limits.depth > 0) && (shared.limits.depth < maxDepth)) {
+        maxDepth = shared.limits.depth;
+    }
+    /* a pass adds a ply without using up depth */
+    if (maxDepth > SEARCH_MAX_PLY/2 - 2) {
+        maxDepth = SEARCH_MAX_PLY/2 - 2;
+    }
+    shared.maxDepth = maxDepth;
+    
+    for (depth = 1; depth <= maxDepth; depth++) {
+        iteration = search_clock();
+        score = search_root(search, game->threads, depth, &move);
+        if (shared.stop) {
+            /* root moves finished before the cut off are fully searched */
+            if (shared.alpha > -SCORE_INF) {
+                best = shared.bestMove;
+                bestScore = shared.alpha;
+            }
+            break;
+        }
+        best = move;
+        bestScore = score;
+        /* a helper a ply deeper may have finished first */
+        done = shared.doneDepth;
+        depth = done;
+        /* a proven result can't change with more depth */
+        if ((score >= SCORE_WIN) || (score <= -SCORE_WIN)) {
+            break;
+        }
+        /* no new iteration past the soft limit, or to overrun the hard: */
+        /* the next grows like this one did, if faster than the default */
+        now = search_clock();
+        growth = DEADLINE_GROWTH;
+        if ((last > 0) && ((now - iteration) / last > growth)) {
+            growth = (now - iteration) / last;
+        }
+        last = now - iteration;
+        if ((hard > 0) && ((now >= soft) || (now + last * growth >= hard))) {
+            break;
+        }
+    }
+    /* cut off before any root move: the first valid one will do */
+    if (best < 0) {
+        best = ai_scan(AI_FORWARD, game);
+        if ((best < 0) || !game_move_legal(best, game)) {
+            game_list_moves(game);
+            best = game->moveList[0];
+        }
+    }
+    
+    seconds = search_clock() - shared.start - pondered;
+    for (i = 0; i < game->threads; i++) {
+        nodes += search[i]->nodes;
+        tt_stats_merge(&(game->tt)->stats, &search[i]->ttStats);
+        if (i > 0) {
+#ifdef FLIP_STATS
+            stats_merge(&game->stats, &(search[i]->game)->stats);
+#endif
+            game_free(search[i]->game);
+            free(search[i]->game);
+        }
+        free(search[i]->moves);
+        free(search[i]);
+    }
+    (game->lastSearch).depth = done;
+    (game->lastSearch).score = bestScore;
+    (game->lastSearch).solved = 0;
+    (game->lastSearch).book = 0;
+    /* past the hard limit, there is no time left to look for the reply */
+    (game->lastSearch).reply = shared.cutOff ? -1 : \
+                               search_reply(game, &shared, best);
+    (game->lastSearch).cutOff = shared.cutOff;
+    (game->lastSearch).nodes = nodes;
+    (game->lastSearch).seconds = seconds;
+    free(shared.moves);
+    pthread_mutex_destroy(&shared.lock);
+    return best;
+}
+
+double search_soft_share (gameType * game) {
+    /*
+        Share of the deadline a search may start iterations in: the most 
+            in the middle game, the least at the start, where the book & 
+            the game's simplicity help, & at the end, where the solver 
+            does
+    */
+    double f = (double) game->empties / ((game->board).n * (game->board).n);
+    
+    return DEADLINE_SOFT_MIN + \
+           (DEADLINE_SOFT_MAX - DEADLINE_SOFT_MIN) * 4 * f * (1 - f);
+}
+
+void search_deadline_record (gameType * game, double seconds) {
+    /*
+        Count a move's time against the deadline in the game's totals
+    */
+    deadlineStatsType * stats = &game->deadline;
+    double share = seconds * 1000 / (game->limits).deadlineMs;
+    int bucket = (int) (share * (DEADLINE_BUCKETS - 1));
+    
+    if ((bucket < 0) || (bucket >= DEADLINE_BUCKETS)) {
+        bucket = DEADLINE_BUCKETS - 1;
+    }
+    stats->moves++;
+    stats->histogram[bucket]++;
+    if (share >= DEADLINE_CLOSE) {
+        stats->close++;
+    }
+    if (share > 1) {
+        stats->over++;
+    }
+    if ((game->lastSearch).cutOff) {
+        stats->cutOff++;
+    }
+    if (seconds > stats->worst) {
+        stats->worst = seconds;
+    }
+}
+
+int search_reply (gameType * game, searchSharedType * shared, int best) {
+    /*
+        Return the expected answer to the chosen move: the best line's 
+            second move, or the table's for the position when a stored 
+            result cut the line short; -1 if neither knows
+    */
+    ttEntryType entry;
+    int i, n, reply = -1;
+    bool found;
+    
+    /* the line is the last iteration's, unless that was cut off */
+    if ((shared->pvLength > 1) && (shared->pv[0] == best)) {
+        return shared->pv[1];
+    }
+    game_make_move(best, game);
+    n = game_list_moves(game);
+    found = tt_probe(game->tt, &(game->tt)->stats, game->hash, &entry);
+    for (i = 0; found && (i < n); i++) {
+        if (game->moveList[i] == entry.move) {
+            reply = entry.move;
+        }
+    }
+    game_unmake_move(game);
+    return reply;
+}
+
+int search_root (searchType * search[], int threads, int depth, int * best) {
+    /*
+        Search every move from the root position to 'depth' plies;
+            returns the score & writes the best move. Lazy SMP: every 
+            thread searches the whole tree, the helpers taking the root 
+            moves in other orders & every other one a ply deeper, so 
+            they fill the shared transposition table ahead of each 
+            other. The first thread to finish ends the iteration, & its 
+            result stands.
+    */
+    searchSharedType * shared = search[0]->shared;
+    gameType * game = search[0]->game;
+    pthread_t helper[SEARCH_MAX_THREADS];
+    int i, n;
+    
+    /* root moves: the previous iteration's best first */
+    n = game_list_moves(game);
+    memcpy(shared->moves, game->moveList, n * sizeof(int));
+    for (i = 1; (depth > 1) && (i < n); i++) {
+        if (shared->moves[i] == shared->pv[0]) {
+            shared->moves[i] = shared->moves[0];
+            shared->moves[0] = shared->pv[0];
+        }
+    }
+    shared->nMoves = n;
+    shared->depth = depth;
+    shared->alpha = -SCORE_INF;
+    shared->bestMove = shared->moves[0];
+    shared->finished = 0;
+    /* every thread starts this iteration from the last best line */
+    for (i = 0; i < threads; i++) {
+        memcpy(search[i]->pv[0], shared->pv, shared->pvLength * sizeof(int));
+        search[i]->pvLength[0] = shared->pvLength;
+    }
+    
+    for (i = 1; i < threads; i++) {
+        pthread_create(&helper[i], NULL, search_root_moves, search[i]);
+    }
+    search_root_moves(search[0]);
+    for (i = 1; i < threads; i++) {
+        pthread_join(helper[i], NULL);
+    }
+    
+    *best = shared->bestMove;
+    return shared->alpha;
+}
+
+void * search_root_moves (void * arg) {
+    /*
+        Thread body: search every root move in this thread's order, 
+            recording any that beat the best so far, & the whole result
+            if this thread is the first to finish
+    */
+    searchType * search = (searchType *) arg;
+    searchSharedType * shared = search->shared;
+    gameType * game = search->game;
+    int i, n = shared->nMoves, depth, skew, move, score;
+    int alpha = -SCORE_INF, best = shared->moves[0];
+    
+    search->stop = 0;
+    depth = shared->depth + (search->id % 2);
+    if (depth > shared->maxDepth) {
+        depth = shared->depth;
+    }
+    /* the best guess first, then the rest from a point of this thread's */
+    skew = (n > 1) ? search->id % (n - 1) : 0;
+    search->moves[0] = shared->moves[0];
+    for (i = 1; i < n; i++) {
+        search->moves[i] = shared->moves[1 + (i - 1 + skew) % (n - 1)];
+    }
+    search->nMoves = n;
+    
+    for (i = 0; i < n; i++) {
+        move = search->moves[i];
+        /* only the first move continues along the previous best line */
+        search->followPv = (i == 0);
+        game_make_move(move, game);
+        score = -search_negamax(search, depth - 1, 1, -SCORE_INF, -alpha);
+        game_unmake_move(game);
+        if (search->stop) {
+            break;
+        }
+        if (score <= alpha) {
+            continue;
+        }
+        /* new best line: this move, then the reply's best line */
+        alpha = score;
+        best = move;
+        search->pv[0][0] = move;
+        memcpy(&search->pv[0][1], &search->pv[1][1], \
+               search->pvLength[1] * sizeof(int));
+        search->pvLength[0] = search->pvLength[1] + 1;
+        pthread_mutex_lock(&shared->lock);
+        if (!shared->finished && (score > shared->alpha)) {
+            shared->alpha = score;
+            shared->bestMove = move;
+            memcpy(shared->pv, search->pv[0], \
+                   search->pvLength[0] * sizeof(int));
+            shared->pvLength = search->pvLength[0];
+        }
+        pthread_mutex_unlock(&shared->lock);
+    }
+    search->nMoves = 0;
+    if (search->stop) {
+        return NULL;
+    }
+    /* done first: this thread's result is the iteration's */
+    pthread_mutex_lock(&shared->lock);
+    if (!shared->finished) {
+        shared->alpha = alpha;
+        shared->bestMove = best;
+        memcpy(shared->pv, search->pv[0], search->pvLength[0] * sizeof(int));
+        shared->pvLength = search->pvLength[0];
+        shared->doneDepth = depth;
+        __atomic_store_n(&shared->finished, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&shared->lock);
+    return NULL;
+}
+
+int search_negamax (searchType * search, int depth, int ply, \
+                    int alpha, int beta) {
+    /*
+        Return the score of the position at 'ply' for the player to move,
+            looking 'depth' moves ahead. Every move made on the game is
+            unmade before returning.
+    */
+    gameType * game = search->game;
+    ttEntryType entry;
+    int i, n, base, move, score, best = -SCORE_INF, bestMove = -1;
+    int first = -1, alphaIn = alpha;
+    
+    search->pvLength[ply] = 0;
+    search->nodes++;
+    STATS_COUNT(game, nodes);
+    if (search->nodes >= (search->check).at) {
+        search_check_limits(search);
+    }
+    /* another thread finishing the iteration ends it for this one too */
+    if (__atomic_load_n(&(search->shared)->finished, __ATOMIC_RELAXED)) {
+        search->stop = 1;
+    }
+    if (search->stop) {
+        return 0;
+    }
+    if (game->empties == 0) {
+        return search_final(game);
+    }
+    n = game_list_moves(game);
+    
+    /* no moves: pass, or the game is over if the other player passed */
+    if (n == 0) {
+        if (game->passes > 0) {
+            return search_final(game);
+        }
+        game_make_pass(game);
+        score = -search_negamax(search, depth, ply+1, -beta, -alpha);
+        game_unmake_move(game);
+        return score;
+    }
+    if (depth == 0) {
+        return search_eval(game);
+    }
+    
+    /* a stored result may settle this node, or at least suggest a move */
+    STATS_COUNT(game, ttProbes);
+    if (tt_probe(game->tt, &search->ttStats, game->hash, &entry)) {
+        for (i = 0; (i < n) && (game->moveList[i] != entry.move); i++);
+        if ((entry.move >= 0) && (i == n)) {
+            /* the key matched a different position */
+            (search->ttStats).collisions++;
+        } else {
+            STATS_COUNT(game, ttHits);
+            first = entry.move;
+            if ((ply > 0) && (entry.depth >= depth) && \
+                ((entry.flag == TT_EXACT) || \
+                 ((entry.flag == TT_LOWER) && (entry.score >= beta)) || \
+                 ((entry.flag == TT_UPPER) && (entry.score <= alpha)))) {
+                return entry.score;
+            }
+        }
+    }
+    
+    /* keep this ply's moves on the move stack, above its parents' */
+    base = search->nMoves;
+    if (base + n > search->movesCapacity) {
+        search->movesCapacity = 2 * (base + n);
+        search->moves = (int *) realloc(search->moves, \
+                                        search->movesCapacity * sizeof(int));
+    }
+    memcpy(&search->moves[base], game->moveList, n * sizeof(int));
+    search->nMoves += n;
+    /* try the previous iteration's best move first, else the stored one */
+    if (search->followPv) {
+        search->followPv = 0;
+        for (i = base; i < base + n; i++) {
+            if ((ply < search->pvLength[0]) && \
+                (search->moves[i] == search->pv[0][ply])) {
+                first = search->pv[0][ply];
+                search->followPv = 1;
+                break;
+            }
+        }
+    }
+    for (i = base; i < base + n; i++) {
+        if (search->moves[i] == first) {
+            search->moves[i] = search->moves[base];
+            search->moves[base] = first;
+            break;
+        }
+    }
+    
+    for (i = base; i < base + n; i++) {
+        move = search->moves[i];
+        game_make_move(move, game);
+        score = -search_negamax(search, depth-1, ply+1, -beta, -alpha);
+        game_unmake_move(game);
+        if (search->stop) {
+            break;
+        }
+        if (score > best) {
+            best = score;
+            bestMove = move;
+            /* new best line: this move, then the child's best line */
+            search->pv[ply][ply] = move;
+            memcpy(&search->pv[ply][ply+1], &search->pv[ply+1][ply+1], \
+                   search->pvLength[ply+1] * sizeof(int));
+            search->pvLength[ply] = search->pvLength[ply+1] + 1;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            STATS_COUNT(game, cutoffs);
+            break;
+        }
+    }
+    search->nMoves = base;
+    if (!search->stop) {
+        tt_store(game->tt, &search->ttStats, game->hash, depth, \
+                 (best <= alphaIn) ? TT_UPPER : \
+                 (best >= beta) ? TT_LOWER : TT_EXACT, best, bestMove);
+    }
+    return best;
+}
+
+int search_eval (gameType * game) {
+    /*
+        Heuristic score for the player to move, from the pattern tables
+    */
+    return eval_score(game);
+}
+
+int search_final (gameType * game) {
+    /*
+        Exact score of a finished game for the player to move
+    */
+    int margin = game->scoreO - game->scoreX;
+    
+    if (game->whoseTurn == 'X') {
+        margin = -margin;
+    }
+    if (margin > 0) {
+        return SCORE_WIN + margin;
+    } else if (margin < 0) {
+        return -SCORE_WIN + margin;
+    }
+    return 0;
+}
+
+void search_check_limits (searchType * search) {
+    /*
+        Stop every thread's search once they are out of nodes or time, at
+            the deadline's hard limit, or when the game's abort flag is set
+    */
+    searchSharedType * shared = search->shared;
+    clockCheckType * check = &search->check;
+    long nodes;
+    double now, stopAt;
+    
+    nodes = __atomic_add_fetch(&shared->nodes, check->nodes, __ATOMIC_RELAXED);
+    if ((shared->limits.nodes > 0) && (nodes >= shared->limits.nodes)) {
+        __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+    }
+    /* only a search against the clock reads it, & tunes its checks */
+    if ((shared->limits.timeMs > 0) || (shared->hard > 0)) {
+        /* the sooner of the time limit & the hard limit */
+        stopAt = (shared->limits.timeMs > 0) ? \
+                 shared->start + shared->limits.timeMs / 1e3 : shared->hard;
+        if ((shared->hard > 0) && (shared->hard < stopAt)) {
+            stopAt = shared->hard;
+        }
+        now = search_clock_check(check, search->nodes, stopAt);
+        if ((shared->limits.timeMs > 0) && \
+            ((now - shared->start) * 1000 >= shared->limits.timeMs)) {
+            __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+        }
+        if ((shared->hard > 0) && (now >= shared->hard)) {
+            __atomic_store_n(&shared->cutOff, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        check->at = search->nodes + check->nodes;
+    }
+    if ((shared->abort != NULL) && \
+        __atomic_load_n(shared->abort, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+    }
+    if (__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) {
+        search->stop = 1;
+    }
+}
+
+double search_clock_check (clockCheckType * check, long nodes, 
+                           double stopAt) {
+    /*
+        Read the clock for a check at 'nodes' nodes & set the next check
+            about SEARCH_CHECK_US on (up to SEARCH_CHECK_NODES), at the 
+            rate the nodes since the last check went, & no later than 
+            'stopAt' (if not 0) at that rate, so the checks close in on it
+    */
+    double now = search_clock(), since = now - check->last, next;
+    
+    next = SEARCH_CHECK_NODES;
+    if (since * SEARCH_CHECK_NODES > check->nodes * SEARCH_CHECK_US * 1e-6) {
+        next = check->nodes * SEARCH_CHECK_US * 1e-6 / since;
+    }
+    if ((stopAt > now) && (since * next > check->nodes * (stopAt - now))) {
+        next = check->nodes * (stopAt - now) / since;
+    }
+    check->nodes = (next < 1) ? 1 : (long) next;
+    check->last = now;
+    check->at = nodes + check->nodes;
+    return now;
+}
+
+double search_clock (void) {
+    /*
+        Monotonic wall-clock time in seconds
+    */
+    struct timespec t;
+    
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Evaluation */
+
+evalType * eval_open (char * fname, boardType * board) {
+    /*
+        Set up the pattern tables for a board: map the weight file for its
+            size (EVAL_FILE if fname is NULL), or use the built-in weights
+            if there is none or it doesn't match
+    */
+    char name[64];
+    struct stat info;
+    evalType * eval = (evalType * ) malloc(sizeof(evalType));
+    evalHeaderType * header;
+    int c, i, k, x, y, dx, dy, pos, power, line, pattern, cells;
+    int * count;
+    
+    /* weights */
+    eval->map = NULL;
+    if (fname == NULL) {
+        snprintf(name, sizeof(name), EVAL_FILE, board->n);
+        fname = name;
+    }
+    i = open(fname, O_RDONLY);
+    if ((i >= 0) && (fstat(i, &info) == 0) && (info.st_size == \
+            sizeof(evalHeaderType) + EVAL_WEIGHTS * sizeof(int16_t))) {
+        eval->map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, i, 0);
+        eval->size = info.st_size;
+        header = (evalHeaderType *) eval->map;
+        if (eval->map == MAP_FAILED) {
+            eval->map = NULL;
+        } else if (memcmp(header->magic, EVAL_MAGIC, 8) || \
+                   (header->version != EVAL_VERSION) || \
+                   (header->dim != board->n) || \
+                   (header->count != EVAL_WEIGHTS)) {
+            munmap(eval->map, eval->size);
+            eval->map = NULL;
+        }
+    }
+    if (i >= 0) {
+        close(i);
+    }
+    if (eval->map != NULL) {
+        eval->weights = (int16_t *) ((evalHeaderType *) eval->map + 1);
+    } else {
+        eval->weights = (int16_t *) malloc(EVAL_WEIGHTS * sizeof(int16_t));
+        eval_defaults(eval->weights);
+    }
+    
+    /* the patterns each cell is in: counted, then listed */
+    cells = board->stride * board->stride;
+    count = (int *) calloc(cells + 1, sizeof(int));
+    eval->cellStart = (int *) malloc((cells + 1) * sizeof(int));
+    eval->refs = (evalRefType *) malloc((4 * 9 + 12 * EVAL_LINE) * \
+                                        sizeof(evalRefType));
+    line = (board->n < EVAL_LINE) ? board->n : EVAL_LINE;
+    for (k = 0; k < 2; k++) {
+        for (c = 0; c < 4; c++) {
+            dx = (c & 1) ? -1 : 1;
+            dy = (c & 2) ? -1 : 1;
+            x = (c & 1) ? board->n - 1 : 0;
+            y = (c & 2) ? board->n - 1 : 0;
+            for (i = 0, power = 1; i < 9 + 3 * line; i++) {
+                /* 3x3 block, then edge along x, edge along y, diagonal */
+                if (i < 9) {
+                    pattern = c;
+                    pos = BOARD_POS(board, x + (i / 3) * dx, y + (i % 3) * dy);
+                } else if (i < 9 + line) {
+                    pattern = 4 + 2 * c;
+                    pos = BOARD_POS(board, x + (i - 9) * dx, y);
+                } else if (i < 9 + 2 * line) {
+                    pattern = 5 + 2 * c;
+                    pos = BOARD_POS(board, x, y + (i - 9 - line) * dy);
+                } else {
+                    pattern = 12 + c;
+                    pos = BOARD_POS(board, x + (i - 9 - 2 * line) * dx, 
+                                    y + (i - 9 - 2 * line) * dy);
+                }
+                power = ((i == 0) || (i == 9) || (i == 9 + line) || \
+                         (i == 9 + 2 * line)) ? 1 : 3 * power;
+                if (k == 0) {
+                    count[pos + 1]++;
+                } else {
+                    eval->refs[count[pos]].pattern = pattern;
+                    eval->refs[count[pos]++].power = power;
+                }
+            }
+        }
+        /* counts to starts */
+        if (k == 0) {
+            for (i = 0; i < cells; i++) {
+                count[i + 1] += count[i];
+            }
+            memcpy(eval->cellStart, count, (cells + 1) * sizeof(int));
+        }
+    }
+    free(count);
+    return eval;
+}
+
+void eval_close (evalType * eval) {
+    /*
+        Free the tables from eval_open (or do nothing for NULL)
+    */
+    if (eval == NULL) {
+        return;
+    }
+    if (eval->map != NULL) {
+        munmap(eval->map, eval->size);
+    } else {
+        free(eval->weights);
+    }
+    free(eval->cellStart);
+    free(eval->refs);
+    free(eval);
+}
+
+
+int eval_save (char * fname, int dim, int16_t * weights) {
+    /*
+        Write a weight file for eval_open (EVAL_FILE if fname is NULL); 
+            returns FLIP_OK or FLIP_ERR_SAVE
+    */
+    char name[64], * tmp;
+    evalHeaderType header;
+    FILE * f;
+    bool ok;
+    
+    if (fname == NULL) {
+        snprintf(name, sizeof(name), EVAL_FILE, dim);
+        fname = name;
+    }
+    memset(&header, 0, sizeof(evalHeaderType));
+    memcpy(header.magic, EVAL_MAGIC, 8);
+    header.version = EVAL_VERSION;
+    header.dim = dim;
+    header.count = EVAL_WEIGHTS;
+    /* running engines may have the old weights mapped: don't truncate */
+    f = save_replace_open(fname, &tmp);
+    ok = (f != NULL) && \
+         (fwrite(&header, sizeof(evalHeaderType), 1, f) == 1) && \
+         (fwrite(weights, sizeof(int16_t), EVAL_WEIGHTS, f) == EVAL_WEIGHTS);
+    return save_replace_close(f, tmp, fname, ok);
+}
+
+void eval_defaults (int16_t * weights) {
+    /*
+        Built-in weights: only the corners, at SCORE_CORNER discs each, so
+            the evaluation is the disc margin with corners counted extra
+    */
+    int i;
+    
+    memset(weights, 0, EVAL_WEIGHTS * sizeof(int16_t));
+    for (i = 0; i < EVAL_EDGE - EVAL_CORNER; i++) {
+        /* the corner is the first cell of its block */
+        weights[EVAL_CORNER + i] = (i % 3 == 1) ? SCORE_CORNER * EVAL_SCALE :
+                                   (i % 3 == 2) ? -SCORE_CORNER * EVAL_SCALE : 0;
+    }
+}
+
+void eval_reset (gameType * game) {
+    /*
+        Work out every pattern's index from the board
+    */
+    evalType * eval = game->eval;
+    int i, pos, digit, cells = (game->board).stride * (game->board).stride;
+    const int32_t offset[4] = { EVAL_CORNER, EVAL_EDGE, EVAL_EDGE, EVAL_DIAG };
+    
+    for (i = 0; i < EVAL_PATTERNS; i++) {
+        game->evalIndex[i] = offset[(i < 4) ? 0 : (i < 12) ? 1 : 3];
+    }
+    for (pos = 0; pos < cells; pos++) {
+        digit = ((game->board).s[pos] == 'O') ? 1 : \
+                ((game->board).s[pos] == 'X') ? 2 : 0;
+        for (i = eval->cellStart[pos]; i < eval->cellStart[pos + 1]; i++) {
+            game->evalIndex[(eval->refs)[i].pattern] += \
+                digit * (eval->refs)[i].power;
+        }
+    }
+}
+
+void eval_update (int pos, int * flips, int nFlips, char tile, int sign, \
+                  gameType * game) {
+    /*
+        Move the pattern indices by a move placing 'tile' at pos & flipping
+            'flips' (sign 1), or by taking it back (sign -1)
+    */
+    evalType * eval = game->eval;
+    evalRefType * ref, * end;
+    int i, digit = sign * ((tile == 'O') ? 1 : 2);
+    int flip = sign * ((tile == 'O') ? -1 : 1);
+    
+    if (eval == NULL) {
+        return;
+    }
+    end = &eval->refs[eval->cellStart[pos + 1]];
+    for (ref = &eval->refs[eval->cellStart[pos]]; ref < end; ref++) {
+        game->evalIndex[ref->pattern] += digit * ref->power;
+    }
+    for (i = 0; i < nFlips; i++) {
+        end = &eval->refs[eval->cellStart[flips[i] + 1]];
+        for (ref = &eval->refs[eval->cellStart[flips[i]]]; ref < end; ref++) {
+            game->evalIndex[ref->pattern] += flip * ref->power;
+        }
+    }
+}
+
+int eval_score (gameType * game) {
+    /*
+        Heuristic score in discs for the player to move: the disc margin,
+            the pattern weights & the weight of the mover's move count 
+            (game->nMoves, as listed before evaluating)
+    */
+    int16_t * weights = (game->eval)->weights;
+    int score;
+    
+    pthread_once(&evalKernelOnce, eval_kernel_pick);
+    score = (game->scoreO - game->scoreX) * EVAL_SCALE + \
+            eval_sum(game->evalIndex, weights);
+    if (game->whoseTurn == 'X') {
+        score = -score;
+    }
+    score += weights[EVAL_MOBILITY + ((game->nMoves < EVAL_MOVES) ? \
+                                      game->nMoves : EVAL_MOVES - 1)];
+    return score / EVAL_SCALE;
+}
+
+void eval_kernel_pick (void) {
+    /*
+        Pick the pattern summing kernel: AVX2 gathers if the CPU has them
+    */
+    eval_sum = eval_sum_scalar;
+#ifdef WIDE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        eval_sum = eval_sum_avx2;
+    }
+#endif
+}
+
+int eval_sum_scalar (const int32_t * index, const int16_t * weights) {
+    /*
+        Total weight of the patterns, one at a time
+    */
+    int i, sum = 0;
+    
+    for (i = 0; i < EVAL_PATTERNS; i++) {
+        sum += weights[index[i]];
+    }
+    return sum;
+}
+
+#ifdef WIDE_X86
+__attribute__((target("avx2")))
+int eval_sum_avx2 (const int32_t * index, const int16_t * weights) {
+    /*
+        Total weight of the patterns, 8 at a time: each gather reads 32 
+            bits at a weight, keeping the (sign-extended) low 16. The
+            mobility table after the patterns keeps the reads in bounds.
+    */
+    __m256i a, b;
+    __m128i sum;
+    
+    a = _mm256_loadu_si256((const __m256i *) index);
+    b = _mm256_loadu_si256((const __m256i *) (index + 8));
+    a = _mm256_i32gather_epi32((const int *) weights, a, 2);
+    b = _mm256_i32gather_epi32((const int *) weights, b, 2);
+    a = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+    b = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+    a = _mm256_add_epi32(a, b);
+    sum = _mm_add_epi32(_mm256_castsi256_si128(a), 
+                        _mm256_extracti128_si256(a, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+#else
+int eval_sum_avx2 (const int32_t * index, const int16_t * weights) {
+    /*
+        No AVX2 on this target
+    */
+    return eval_sum_scalar(index, weights);
+}
+#endif
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Opening book */
+
+bookType * book_open (char * fname, int dim) {
+    /*
+        Map a book file for the board size (BOOK_FILE if fname is NULL);
+            returns NULL if there is none or it doesn't match
+    */
+    char name[64];
+    struct stat info;
+    bookType * book;
+    void * map;
+    int fd;
+    
+    if (fname == NULL) {
+        snprintf(name, sizeof(name), BOOK_FILE, dim);
+        fname = name;
+    }
+    fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((fstat(fd, &info) != 0) || (info.st_size < sizeof(bookHeaderType))) {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+    book = (bookType *) malloc(sizeof(bookType));
+    book->map = map;
+    book->size = info.st_size;
+    book->header = (bookHeaderType *) map;
+    book->entries = (bookEntryType *) (book->header + 1);
+    if (memcmp(book->header->magic, BOOK_MAGIC, 8) || \
+        (book->header->version != BOOK_VERSION) || \
+        (book->header->dim != dim) || (book->size != \
+         sizeof(bookHeaderType) + book->header->count * sizeof(bookEntryType))) {
+        book_close(book);
+        return NULL;
+    }
+    return book;
+}
+
+void book_close (bookType * book) {
+    /*
+        Unmap a book from book_open (or do nothing for NULL)
+    */
+    if (book == NULL) {
+        return;
+    }
+    munmap(book->map, book->size);
+    free(book);
+}
+
+int book_move (gameType * game) {
+    /*
+        Return the book's move for the position, or -1 if it isn't there
+    */
+    bookType * book = game->book;
+    int i, sym, lo, hi, mid, n = (game->board).n;
+    uint64_t key;
+    
+    /* the book only covers the first few moves */
+    if ((book == NULL) || (n*n - 4 - game->empties >= book->header->plies)) {
+        return -1;
+    }
+    key = book_key(game, &sym);
+    lo = 0;
+    hi = book->header->count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (book->entries[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if ((lo == book->header->count) || (book->entries[lo].key != key)) {
+        return -1;
+    }
+    /* find the valid move the book's move stands for */
+    game_list_moves(game);
+    for (i = 0; i < game->nMoves; i++) {
+        if (book_transform((game->moveList)[i], sym, &game->board) == \
+                book->entries[lo].move) {
+            (game->lastSearch).depth = 0;
+            (game->lastSearch).score = book->entries[lo].score;
+            (game->lastSearch).nodes = 0;
+            (game->lastSearch).seconds = 0;
+            (game->lastSearch).solved = 0;
+            (game->lastSearch).book = 1;
+            (game->lastSearch).reply = -1;
+            (game->lastSearch).cutOff = 0;
+            return (game->moveList)[i];
+        }
+    }
+    return -1;
+}
+
+uint64_t book_key (gameType * game, int * sym) {
+    /*
+        Return the smallest Zobrist key of the position over the 8 board
+            symmetries, & write which symmetry gave it
+    */
+    uint64_t key[8], side = (game->whoseTurn == 'X') ? ZOBRIST_SIDE : 0;
+    int i, s, x, y, pos, n = (game->board).n;
+    char cell;
+    
+    for (s = 0; s < 8; s++) {
+        key[s] = side;
+    }
+    for (x = 0; x < n; x++) {
+        for (y = 0; y < n; y++) {
+            cell = CELL(&game->board, x, y);
+            if (cell == '.') {
+                continue;
+            }
+            pos = BOARD_POS(&game->board, x, y);
+            for (s = 0; s < 8; s++) {
+                i = book_transform(pos, s, &game->board);
+                key[s] ^= game->zobrist[2*i + (cell == 'X')];
+            }
+        }
+    }
+    *sym = 0;
+    for (s = 1; s < 8; s++) {
+        if (key[s] < key[*sym]) {
+            *sym = s;
+        }
+    }
+    return key[*sym];
+}
+
+int book_transform (int pos, int sym, boardType * board) {
+    /*
+        Return the cell a cell moves to under one of the 8 symmetries:
+            bit 0 swaps the axes, bits 1 & 2 mirror x & y
+    */
+    int x = pos / board->stride - 1, y = pos % board->stride - 1, swap;
+    
+    if (sym & 1) {
+        swap = x;
+        x = y;
+        y = swap;
+    }
+    if (sym & 2) {
+        x = board->n - 1 - x;
+    }
+    if (sym & 4) {
+        y = board->n - 1 - y;
+    }
+    return BOARD_POS(board, x, y);
+}
+
+int book_build (gameType * game, int plies, char * fname, long * count) {
+    /*
+        Search every position up to 'plies' moves into the game (within 
+            the game's search limits) & write the best moves as a book 
+            (to BOOK_FILE if fname is NULL). Returns FLIP_OK or 
+            FLIP_ERR_SAVE, & the number of positions in *count.
+    */
+    bookHeaderType header;
+    bookBuildType build;
+    char name[64], * tmp;
+    FILE * f;
+    bool ok = 0;
+    
+    build.count = 0;
+    build.capacity = 1024;
+    build.entries = (bookEntryType *) malloc(build.capacity * \
+                                             sizeof(bookEntryType));
+    build.seenMask = 2 * build.capacity - 1;
+    build.seen = (uint64_t *) calloc(build.seenMask + 1, sizeof(uint64_t));
+    book_build_walk(game, plies, &build);
+    /* sort for binary search */
+    qsort(build.entries, build.count, sizeof(bookEntryType), book_compare);
+    *count = build.count;
+    
+    memset(&header, 0, sizeof(bookHeaderType));
+    memcpy(header.magic, BOOK_MAGIC, 8);
+    header.version = BOOK_VERSION;
+    header.dim = (game->board).n;
+    header.plies = plies;
+    header.count = build.count;
+    if (fname == NULL) {
+        snprintf(name, sizeof(name), BOOK_FILE, (game->board).n);
+        fname = name;
+    }
+    /* other processes may have the old book mapped: don't truncate it */
+    f = save_replace_open(fname, &tmp);
+    if (f != NULL) {
+        ok = (fwrite(&header, sizeof(bookHeaderType), 1, f) == 1) && \
+             (fwrite(build.entries, sizeof(bookEntryType), build.count, f) \
+              == build.count);
+    }
+    free(build.entries);
+    free(build.seen);
+    return save_replace_close(f, tmp, fname, ok);
+}
+
+void book_build_walk (gameType * game, int plies, bookBuildType * build) {
+    /*
+        Add the position & everything up to 'plies' moves on to the book,
+            searching each new position once
+    */
+    bookEntryType * entry;
+    int i, n, sym, * moves;
+    uint64_t key;
+    
+    n = game_list_moves(game);
+    if ((plies == 0) || (n == 0)) {
+        return;
+    }
+    key = book_key(game, &sym);
+    if (book_build_seen(build, key)) {
+        return;
+    }
+    moves = (int *) malloc(n * sizeof(int));
+    memcpy(moves, game->moveList, n * sizeof(int));
+    if (build->count == build->capacity) {
+        build->capacity *= 2;
+        build->entries = (bookEntryType *) realloc(build->entries, \
+                                build->capacity * sizeof(bookEntryType));
+    }
+    entry = &build->entries[(build->count)++];
+    entry->key = key;
+    entry->move = book_transform(search_move(game), sym, &game->board);
+    entry->score = (game->lastSearch).score;
+    
+    for (i = 0; i < n; i++) {
+        game_make_move(moves[i], game);
+        book_build_walk(game, plies - 1, build);
+        game_unmake_move(game);
+    }
+    free(moves);
+}
+
+bool book_build_seen (bookBuildType * build, uint64_t key) {
+    /*
+        Return whether the key is already in the book being built, & add 
+            it if not. The set is kept at most half full.
+    */
+    uint64_t i, * old, oldMask;
+    
+    for (i = key & build->seenMask; build->seen[i]; \
+            i = (i + 1) & build->seenMask) {
+        if (build->seen[i] == key) {
+            return 1;
+        }
+    }
+    build->seen[i] = key;
+    if (2 * (build->count + 1) > build->seenMask) {
+        old = build->seen;
+        oldMask = build->seenMask;
+        build->seenMask = 2 * oldMask + 1;
+        build->seen = (uint64_t *) calloc(build->seenMask + 1, \
+                                          sizeof(uint64_t));
+        for (i = 0; i <= oldMask; i++) {
+            if (old[i]) {
+                book_build_seen(build, old[i]);
+            }
+        }
+        free(old);
+    }
+    return 0;
+}
+
+int book_compare (const void * a, const void * b) {
+    /*
+        Order book entries by key, for qsort
+    */
+    uint64_t x = ((bookEntryType *) a)->key, y = ((bookEntryType *) b)->key;
+    
+    return (x > y) - (x < y);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Endgame solver */
+
+int solve_move (gameType * game, double stopAt) {
+    /*
+        Search to the end of the game for the move with the best final 
+            disc margin. Returns the move & records the margin in 
+            game->lastSearch, or gives up & returns -1 if not done by the
+            clock time 'stopAt' (0 for no limit). Otherwise not bound by 
+            the search limits: game->endgame keeps the cost down.
+    */
+    solverType solver;
+    int i, n, bit, move, score, best = -1, alpha = -SCORE_INF;
+    int cells = (game->board).n * (game->board).n;
+    uint64_t own, opp;
+    double start = search_clock();
+    
+    memset(&solver, 0, sizeof(solverType));
+    solver.game = game;
+    solver.mask = (game->bits).mask;
+    solver.stopAt = stopAt;
+    (solver.check).at = (stopAt > 0) ? 1 : LONG_MAX;
+    (solver.check).nodes = 1;
+    (solver.check).last = start;
+    for (i = 0; i < (game->board).stride * (game->board).stride; i++) {
+        if ((game->board).s[i] == BOARD_EDGE) {
+            continue;
+        }
+        if (game->engine == ENGINE_BB64) {
+            bit = bb_from_pos(i, &game->board);
+            solver.region[solve_region(i, &game->board)] |= 1ULL << bit;
+        } else if ((game->board).s[i] == '.') {
+            solver.regionEmpties[solve_region(i, &game->board)]++;
+        }
+    }
+    /* room for each ply's moves: a ply fills at least one cell */
+    solver.moves = (int *) malloc((game->empties + 2) * cells * sizeof(int));
+    n = game_list_moves(game);
+    memcpy(solver.moves, game->moveList, n * sizeof(int));
+    solver.nMoves = n;
+    
+    for (i = 0; i < n; i++) {
+        move = solver.moves[i];
+        game_make_move(move, game);
+        if (game->engine == ENGINE_BB64) {
+            own = (game->whoseTurn == 'O') ? (game->bits).o : (game->bits).x;
+            opp = (game->whoseTurn == 'O') ? (game->bits).x : (game->bits).o;
+            score = -solve_bb(&solver, own, opp, -SCORE_INF, -alpha, 0);
+        } else {
+            solver.regionEmpties[solve_region(move, &game->board)]--;
+            score = -solve_game(&solver, -SCORE_INF, -alpha);
+            solver.regionEmpties[solve_region(move, &game->board)]++;
+        }
+        game_unmake_move(game);
+        if (solver.stop) {
+            free(solver.moves);
+            return -1;
+        }
+        if (score > alpha) {
+            alpha = score;
+            best = move;
+        }
+    }
+    
+    (game->lastSearch).depth = game->empties;
+    (game->lastSearch).score = alpha;
+    (game->lastSearch).solved = 1;
+    (game->lastSearch).book = 0;
+    (game->lastSearch).reply = -1;
+    (game->lastSearch).cutOff = 0;
+    (game->lastSearch).nodes = solver.nodes;
+    (game->lastSearch).seconds = search_clock() - start;
+    free(solver.moves);
+    return best;
+}
+
+bool solve_out_of_time (solverType * solver) {
+    /*
+        Whether the solver is past its time, checked when due. Once it is,
+            every node checks & returns at once, so the solve unwinds.
+    */
+    double now;
+    
+    if (!solver->stop) {
+        now = search_clock_check(&solver->check, solver->nodes, \
+                                 solver->stopAt);
+        solver->stop = (now >= solver->stopAt);
+    }
+    if (solver->stop) {
+        (solver->check).at = 0;
+    }
+    return solver->stop;
+}
+
+int solve_bb (solverType * solver, uint64_t own, uint64_t opp, \
+              int alpha, int beta, bool passed) {
+    /*
+        Exact final margin for 'own' (to move) on an 8x8 bitboard; 
+            'passed' if the other player just passed
+    */
+    uint64_t empty = solver->mask & ~(own | opp), moves, odd = 0, m, flips;
+    int i, bit, order, score, best = -SCORE_INF, n = bb_count(empty);
+    
+    solver->nodes++;
+    if ((solver->nodes >= (solver->check).at) && solve_out_of_time(solver)) {
+        return 0;
+    }
+    if (n == 0) {
+        return bb_count(own) - bb_count(opp);
+    }
+    if (n == 1) {
+        return solve_bb_last(solver, own, opp, empty);
+    }
+    /* with few empties, trying each is cheaper than finding the moves */
+    moves = (n <= 3) ? empty : bb_valid_moves(own, opp, solver->mask);
+    for (i = 0; i < 4; i++) {
+        if (bb_count(empty & solver->region[i]) & 1) {
+            odd |= solver->region[i];
+        }
+    }
+    for (order = 0; order < 2; order++) {
+        for (m = moves & (order ? ~odd : odd); m; m &= m - 1) {
+            bit = bb_first(m);
+            flips = bb_flips(bit, own, opp);
+            if (flips == 0) {
+                continue;
+            }
+            score = -solve_bb(solver, opp & ~flips, own | flips | (1ULL << bit),
+                              -beta, -alpha, 0);
+            if (score > best) {
+                best = score;
+                if (score > alpha) {
+                    alpha = score;
+                    if (alpha >= beta) {
+                        return best;
+                    }
+                }
+            }
+        }
+    }
+    /* no moves: pass, or the game is over if the other player passed */
+    if (best == -SCORE_INF) {
+        if (passed) {
+            return bb_count(own) - bb_count(opp);
+        }
+        return -solve_bb(solver, opp, own, -beta, -alpha, 1);
+    }
+    return best;
+}
+
+int solve_bb_last (solverType * solver, uint64_t own, uint64_t opp, \
+                   uint64_t empty) {
+    /*
+        Exact final margin for 'own' with one empty cell left: whoever 
+            can move there does, flipping pieces from the other side
+    */
+    int bit = bb_first(empty), margin = bb_count(own) - bb_count(opp);
+    uint64_t flips;
+    
+    solver->nodes++;
+    flips = bb_flips(bit, own, opp);
+    if (flips) {
+        return margin + 2 * bb_count(flips) + 1;
+    }
+    flips = bb_flips(bit, opp, own);
+    if (flips) {
+        return margin - 2 * bb_count(flips) - 1;
+    }
+    return margin;
+}
+
+int solve_game (solverType * solver, int alpha, int beta) {
+    /*
+        Exact final margin for the player to move, with any engine
+    */
+    gameType * game = solver->game;
+    int i, n, base, move, order, region, score, best = -SCORE_INF;
+    
+    solver->nodes++;
+    if ((solver->nodes >= (solver->check).at) && solve_out_of_time(solver)) {
+        return 0;
+    }
+    if (game->empties == 0) {
+        return solve_margin(game);
+    }
+    n = game_list_moves(game);
+    if (n == 0) {
+        if (game->passes > 0) {
+            return solve_margin(game);
+        }
+        game_make_pass(game);
+        score = -solve_game(solver, -beta, -alpha);
+        game_unmake_move(game);
+        return score;
+    }
+    base = solver->nMoves;
+    memcpy(&solver->moves[base], game->moveList, n * sizeof(int));
+    solver->nMoves += n;
+    
+    for (order = 0; (order < 2) && (alpha < beta); order++) {
+        for (i = base; (i < base + n) && (alpha < beta); i++) {
+            move = solver->moves[i];
+            region = solve_region(move, &game->board);
+            /* odd regions first, then the rest */
+            if ((solver->regionEmpties[region] & 1) == order) {
+                continue;
+            }
+            solver->regionEmpties[region]--;
+            game_make_move(move, game);
+            score = -solve_game(solver, -beta, -alpha);
+            game_unmake_move(game);
+            solver->regionEmpties[region]++;
+            if (score > best) {
+                best = score;
+            }
+            if (score > alpha) {
+                alpha = score;
+            }
+        }
+    }
+    solver->nMoves = base;
+    return best;
+}
+
+int solve_region (int pos, boardType * board) {
+    /*
+        Return the parity region (quarter of the board) of a cell
+    */
+    int x = pos / board->stride - 1, y = pos % board->stride - 1;
+    int half = board->n / 2;
+    
+    return 2 * (x >= half) + (y >= half);
+}
+
+int solve_margin (gameType * game) {
+    /*
+        Disc margin for the player to move
+    */
+    return (game->whoseTurn == 'O') ? game->scoreO - game->scoreX : \
+                                      game->scoreX - game->scoreO;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Monte Carlo tree search */
+
+int mcts_move (gameType * game) {
+    /*
+        Choose a move by UCT tree search over random playouts, on 
+            game->threads threads sharing one tree, within the game's time
+            & playout limits. Returns the most visited move & records the
+            search in game->lastSearch.
+    */
+    mctsSharedType shared;
+    mctsType * mcts[SEARCH_MAX_THREADS];
+    pthread_t helper[SEARCH_MAX_THREADS];
+    mctsNodeType * child;
+    int i, best = -1, cells = (game->board).n * (game->board).n;
+    
+    memset(&shared, 0, sizeof(mctsSharedType));
+    shared.capacity = MCTS_ARENA_MB * 1024L * 1024 / sizeof(mctsNodeType);
+    shared.nodes = (mctsNodeType *) malloc(shared.capacity * \
+                                           sizeof(mctsNodeType));
+    shared.nodes[0].move = -1;
+    shared.nodes[0].state = MCTS_LEAF;
+    shared.nodes[0].visits = 0;
+    shared.nodes[0].wins = 0;
+    shared.used = 1;
+    shared.root = game;
+    shared.limits = game->limits;
+    if ((shared.limits.timeMs <= 0) && (shared.limits.deadlineMs > 0)) {
+        shared.limits.timeMs = shared.limits.deadlineMs * DEADLINE_HARD;
+    }
+    if ((shared.limits.timeMs <= 0) && (shared.limits.nodes <= 0)) {
+        shared.limits.timeMs = SEARCH_TIME_MS;
+    }
+    shared.start = search_clock();
+    
+    /* every thread plays out on its own copy */
+    for (i = 0; i < game->threads; i++) {
+        mcts[i] = (mctsType *) malloc(sizeof(mctsType));
+        mcts[i]->shared = &shared;
+        game_clone(&mcts[i]->game, game);
+        /* a pass & a move for every empty, at most */
+        mcts[i]->path = (int *) malloc((2 * cells + 2) * sizeof(int));
+        mcts[i]->random = ZOBRIST_SEED ^ (i + 1);
+        mcts[i]->depth = 0;
+    }
+    for (i = 1; i < game->threads; i++) {
+        pthread_create(&helper[i], NULL, mcts_playouts, mcts[i]);
+    }
+    mcts_playouts(mcts[0]);
+    for (i = 1; i < game->threads; i++) {
+        pthread_join(helper[i], NULL);
+    }
+    
+    /* the most played move is the most trusted */
+    if (shared.nodes[0].state == MCTS_GROWN) {
+        for (i = 0; i < shared.nodes[0].nChildren; i++) {
+            child = &shared.nodes[shared.nodes[0].child + i];
+            if ((best < 0) || (child->visits > shared.nodes[best].visits)) {
+                best = shared.nodes[0].child + i;
+            }
+        }
+    }
+    (game->lastSearch).depth = 0;
+    for (i = 0; i < game->threads; i++) {
+        if (mcts[i]->depth > (game->lastSearch).depth) {
+            (game->lastSearch).depth = mcts[i]->depth;
+        }
+    }
+    (game->lastSearch).score = ((best >= 0) && shared.nodes[best].visits) ? \
+        50 * shared.nodes[best].wins / shared.nodes[best].visits : 0;
+    (game->lastSearch).solved = 0;
+    (game->lastSearch).book = 0;
+    (game->lastSearch).reply = -1;
+    (game->lastSearch).cutOff = 0;
+    (game->lastSearch).nodes = shared.playouts;
+    (game->lastSearch).seconds = search_clock() - shared.start;
+    best = (best >= 0) ? shared.nodes[best].move : -1;
+    /* out of time before the root grew: any valid move will do */
+    if (best < 0) {
+        game_list_moves(game);
+        best = game->moveList[0];
+    }
+    
+    for (i = 0; i < game->threads; i++) {
+        game_free(&mcts[i]->game);
+        free(mcts[i]->path);
+        free(mcts[i]);
+    }
+    free(shared.nodes);
+    return best;
+}
+
+void * mcts_playouts (void * mcts) {
+    /*
+        Thread body: play out from the root until the limits are reached
+    */
+    mctsType * m = (mctsType *) mcts;
+    mctsSharedType * shared = m->shared;
+    long playouts;
+    
+    while (!__atomic_load_n(&shared->stop, __ATOMIC_RELAXED)) {
+        playouts = __atomic_add_fetch(&shared->playouts, 1, __ATOMIC_RELAXED);
+        if ((shared->limits.nodes > 0) && (playouts > shared->limits.nodes)) {
+            __atomic_sub_fetch(&shared->playouts, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        mcts_playout(m);
+        if ((shared->limits.timeMs > 0) && \
+            ((search_clock() - shared->start) * 1000 >= shared->limits.timeMs)) {
+            __atomic_store_n(&shared->stop, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+void mcts_playout (mctsType * mcts) {
+    /*
+        One playout: walk down the tree by UCT, growing the leaf reached 
+            once it has been visited enough, play randomly to the end of 
+            the game, & credit the result to every node on the way
+    */
+    mctsSharedType * shared = mcts->shared;
+    gameType * game = &mcts->game;
+    mctsNodeType * node = &shared->nodes[0];
+    int i, len = 0, state, result, mover;
+    
+    game_copy(game, shared->root);
+    mcts->path[len++] = 0;
+    __atomic_add_fetch(&node->visits, 1, __ATOMIC_RELAXED);
+    while (1) {
+        state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+        if ((state == MCTS_LEAF) && \
+            (__atomic_load_n(&node->visits, __ATOMIC_RELAXED) > \
+             MCTS_EXPAND_VISITS)) {
+            mcts_grow(mcts, node);
+            state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+        }
+        if ((state != MCTS_GROWN) || (node->nChildren == 0)) {
+            break;
+        }
+        i = mcts_select(mcts, node);
+        node = &shared->nodes[i];
+        mcts->path[len++] = i;
+        __atomic_add_fetch(&node->visits, 1, __ATOMIC_RELAXED);
+        mcts_play(node->move, game);
+    }
+    if (len - 1 > mcts->depth) {
+        mcts->depth = len - 1;
+    }
+    
+    /* result for the player to move at the root: 2 won, 1 drawn, 0 lost */
+    result = mcts_rollout(mcts);
+    if ((shared->root)->whoseTurn == 'X') {
+        result = 2 - result;
+    }
+    /* a node's move was made by the root player at odd depths */
+    for (i = 1; i < len; i++) {
+        mover = (i % 2) ? result : 2 - result;
+        if (mover) {
+            __atomic_add_fetch(&shared->nodes[mcts->path[i]].wins, mover, \
+                               __ATOMIC_RELAXED);
+        }
+    }
+}
+
+int mcts_select (mctsType * mcts, mctsNodeType * node) {
+    /*
+        Return the child to visit by UCT: the best win rate plus an 
+            exploration bonus for the less visited. Unvisited children go
+            first.
+    */
+    mctsNodeType * child = &mcts->shared->nodes[node->child];
+    int i, visits, best = 0;
+    double value, bestValue = -1, logParent;
+    
+    logParent = log((double) __atomic_load_n(&node->visits, __ATOMIC_RELAXED));
+    for (i = 0; i < node->nChildren; i++) {
+        visits = __atomic_load_n(&child[i].visits, __ATOMIC_RELAXED);
+        if (visits == 0) {
+            return node->child + i;
+        }
+        value = __atomic_load_n(&child[i].wins, __ATOMIC_RELAXED) / \
+                (2.0 * visits) + MCTS_UCT_C * sqrt(logParent / visits);
+        if (value > bestValue) {
+            bestValue = value;
+            best = i;
+        }
+    }
+    return node->child + best;
+}
+
+void mcts_grow (mctsType * mcts, mctsNodeType * node) {
+    /*
+        Give a leaf a child for every valid move in its position (the 
+            copy's), or a single pass. Only one thread grows a node; a full
+            arena leaves it a leaf.
+    */
+    mctsSharedType * shared = mcts->shared;
+    gameType * game = &mcts->game;
+    int i, n, at, expect = MCTS_LEAF;
+    mctsNodeType * child;
+    
+    if (!__atomic_compare_exchange_n(&node->state, &expect, MCTS_GROWING, 0, \
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    /* game over: a node with no children */
+    n = (game->empties > 0) ? game_list_moves(game) : 0;
+    if ((n == 0) && ((game->empties == 0) || (game->passes > 0))) {
+        node->nChildren = 0;
+        __atomic_store_n(&node->state, MCTS_GROWN, __ATOMIC_RELEASE);
+        return;
+    }
+    if (n == 0) {
+        game->moveList[0] = -1;
+        n = 1;
+    }
+    at = __atomic_load_n(&shared->used, __ATOMIC_RELAXED);
+    do {
+        if (at + n > shared->capacity) {
+            __atomic_store_n(&node->state, MCTS_LEAF, __ATOMIC_RELEASE);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&shared->used, &at, at + n, 0, \
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    for (i = 0; i < n; i++) {
+        child = &shared->nodes[at + i];
+        child->move = game->moveList[i];
+        child->child = 0;
+        child->nChildren = 0;
+        child->state = MCTS_LEAF;
+        child->visits = 0;
+        child->wins = 0;
+    }
+    node->child = at;
+    node->nChildren = n;
+    __atomic_store_n(&node->state, MCTS_GROWN, __ATOMIC_RELEASE);
+}
+
+int mcts_rollout (mctsType * mcts) {
+    /*
+        Play uniformly random valid moves to the end of the game; returns
+            2 if O won, 1 for a draw, 0 if X won
+    */
+    gameType * game = &mcts->game;
+    int n;
+    
+    while ((game->empties > 0) && (game->passes < 2)) {
+        n = game_list_moves(game);
+        if (n == 0) {
+            mcts_play(-1, game);
+        } else {
+            mcts_play(game->moveList[mcts_random(mcts) % n], game);
+        }
+    }
+    return (game->scoreO > game->scoreX) ? 2 : \
+           (game->scoreO == game->scoreX) ? 1 : 0;
+}
+
+void mcts_play (int move, gameType * game) {
+    /*
+        Play a move, or a pass (-1), on a playout's game
+    */
+    if (move < 0) {
+        game_next_player(game);
+        game->passes++;
+    } else {
+        game_put_tile(move, game);
+        game_next_player(game);
+        game->passes = 0;
+    }
+}
+
+uint64_t mcts_random (mctsType * mcts) {
+    /*
+        Next number from the thread's xorshift64* generator
+    */
+    mcts->random ^= mcts->random >> 12;
+    mcts->random ^= mcts->random << 25;
+    mcts->random ^= mcts->random >> 27;
+    return (mcts->random * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Transposition table */
+
+ttType * tt_new (long megabytes) {
+    /*
+        Allocate the largest power-of-2 number of cache-line buckets that
+            fits in the memory budget
+    */
+    ttType * tt = (ttType *) calloc(1, sizeof(ttType));
+    uint64_t buckets = 1;
+    
+    while (buckets * 2 * sizeof(ttBucketType) <= megabytes * 1048576ULL) {
+        buckets *= 2;
+    }
+    tt->mask = buckets - 1;
+    tt->buckets = (ttBucketType *) aligned_alloc(sizeof(ttBucketType), \
+                                                 buckets * sizeof(ttBucketType));
+    memset(tt->buckets, 0, buckets * sizeof(ttBucketType));
+    return tt;
+}
+
+void tt_free (ttType * tt) {
+    /*
+        Clear memory used by the table
+    */
+    if (tt != NULL) {
+        free(tt->buckets);
+        free(tt);
+    }
+}
+
+void tt_new_search (ttType * tt) {
+    /*
+        Age older entries so they are replaced first & restart statistics
+    */
+    tt->age++;
+    memset(&tt->stats, 0, sizeof(ttStatsType));
+}
+
+bool tt_probe (ttType * tt, ttStatsType * stats, uint64_t hash, \
+               ttEntryType * entry) {
+    /*
+        Copy the entry stored for a position to 'entry'; returns 0 if 
+            there is none. The copy is checked, not the shared entry, so
+            a write racing the probe can only make it miss.
+    */
+    ttBucketType * bucket = &tt->buckets[hash & tt->mask];
+    uint32_t check = (uint32_t) (hash >> 32);
+    int i;
+    
+    stats->probes++;
+    for (i = 0; i < TT_BUCKET; i++) {
+        *entry = bucket->entry[i];
+        if ((entry->flag != 0) && \
+            ((entry->check ^ tt_data(entry)) == check)) {
+            stats->hits++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t tt_data (ttEntryType * entry) {
+    /*
+        Fold an entry's contents into 32 bits for its check
+    */
+    return (uint32_t) entry->move ^ (uint32_t) entry->score ^ \
+           ((uint32_t) entry->depth | ((uint32_t) entry->flag << 8) | \
+            ((uint32_t) entry->age << 16));
+}
+
+void tt_store (ttType * tt, ttStatsType * stats, uint64_t hash, \
+               int depth, int flag, int score, int move) {
+    /*
+        Store a search result. It replaces the same position's entry, or 
+            else the entry least worth keeping: shallow & from old searches.
+    */
+    ttBucketType * bucket = &tt->buckets[hash & tt->mask];
+    ttEntryType * entry, * victim = NULL;
+    uint32_t check = (uint32_t) (hash >> 32);
+    int i, worth, same = 0, victimWorth = INT_MAX;
+    
+    for (i = 0; i < TT_BUCKET; i++) {
+        entry = &bucket->entry[i];
+        same = (entry->check ^ tt_data(entry)) == check;
+        if ((entry->flag == 0) || same) {
+            victim = entry;
+            break;
+        }
+        worth = entry->depth - 4 * (uint8_t) (tt->age - entry->age);
+        if (worth < victimWorth) {
+            victimWorth = worth;
+            victim = entry;
+        }
+    }
+    stats->stores++;
+    if ((victim->flag != 0) && !same) {
+        stats->overwrites++;
+    }
+    /* keep the old best move if this search didn't find one */
+    if ((move >= 0) || !same) {
+        victim->move = move;
+    }
+    victim->score = score;
+    victim->depth = (depth > 255) ? 255 : depth;
+    victim->flag = flag;
+    victim->age = tt->age;
+    victim->check = check ^ tt_data(victim);
+}
+
+void tt_stats_merge (ttStatsType * total, ttStatsType * add) {
+    /*
+        Add one thread's table counts to a total
+    */
+    total->probes += add->probes;
+    total->hits += add->hits;
+    total->collisions += add->collisions;
+    total->stores += add->stores;
+    total->overwrites += add->overwrites;
+}
+
+void tt_report (ttType * tt) {
+    /*
+        Write the last search's table statistics to stderr, with the 
+            share of slots in use sampled from the first buckets
+    */
+    long i, used = 0, sample = (tt->mask + 1 < 1024) ? tt->mask + 1 : 1024;
+    int j;
+    
+    for (i = 0; i < sample; i++) {
+        for (j = 0; j < TT_BUCKET; j++) {
+            used += (tt->buckets[i].entry[j].flag != 0);
+        }
+    }
+    fprintf(stderr, "TT: %ld MB, probes %ld, hits %ld (%.1f%%), "
+            "collisions %ld, stores %ld, overwrites %ld, full %.1f%%\n", 
+            (long) (((tt->mask + 1) * sizeof(ttBucketType)) >> 20), 
+            (tt->stats).probes, (tt->stats).hits, (tt->stats).probes ? \
+            100.0 * (tt->stats).hits / (tt->stats).probes : 0.0, 
+            (tt->stats).collisions, (tt->stats).stores, 
+            (tt->stats).overwrites, 
+            100.0 * used / (sample * TT_BUCKET));
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Boardgame engine */
+
+bool board_walk(int pos, int dir, char tile, boardType * board, int action) {
+    /*
+        Combination of actions when moving along path 'dir' on the board
+            WALK_VALIDATE:  Return if a valid path to another tile exists
+            WALK_REPLACE:   Flip the other players' tiles where possible
+                             (assumes path already validated)
+        Empty cells & the edge ring both end the path.
+    */
+    int enemy_pieces = 0;
+    char enemy = (tile == 'O') ? 'X' : 'O';
+    
+    /* Walk along board */
+    while (1) {
+        /* Move along the path! */
+        pos += dir;
+        /* Exit condition: found player piece */
+        if ((board->s)[pos] == tile) {
+            /* true if the path has enemy pieces (valid/replaced) */
+            return enemy_pieces > 0;
+        }
+        /* Exit condition: walked to empty cell or off board */
+        else if ((board->s)[pos] != enemy) {
+            return 0;
+        }
+        /* Action: found enemy piece */
+        enemy_pieces++;
+        if (action == WALK_REPLACE) {
+            (board->s)[pos] = tile;
+        }
+    }
+}
+
+bool move_valid (int pos, char tile, boardType * board) {
+    /*
+        Return whether the cell is a valid move for the given tile
+    */  
+    int i;
+    
+    /* Exit if position is taken */
+    if ((board->s)[pos] != '.') {
+        return 0;
+    }
+    /* Check for any links with same-player tiles to validate move */
+    for (i = 0; i < 8; i++) {
+        if (board_walk(pos, board->dir[i], tile, board, WALK_VALIDATE)) {
+            return 1;
+        }
+    }
+    /* No linked tiles found */
+    return 0;
+}
+
+void game_update_valid_moves (gameType * game) {
+    /*
+        Refresh the array of valid moves for the current player
+    */
+    int i, n;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    /* incremental engine: kept up to date by game_put_tile */
+    if (game->engine != ENGINE_INCR) {
+        /* wipe old moves & mark the new ones */
+        board_cleanup(&game->validMove);
+        n = game_list_moves(game);
+        for (i = 0; i < n; i++) {
+            (game->validMove).s[(game->moveList)[i]] = game->whoseTurn;
+        }
+    }
+    STATS_STOP(game, STATS_MOVEGEN, timer);
+}
+
+
+bool game_move_legal (int pos, gameType * game) {
+    /*
+        Return whether the cell is a valid move for the current player,
+            from the engine's own move mask where it has one
+    */
+    wideBoardType * wide = &game->wide;
+    uint64_t own, opp;
+    
+    if ((game->board).s[pos] != '.') {
+        return 0;
+    }
+    switch (game->engine) {
+        case ENGINE_BB64:
+            own = (game->whoseTurn == 'O') ? (game->bits).o : (game->bits).x;
+            opp = (game->whoseTurn == 'O') ? (game->bits).x : (game->bits).o;
+            return (bb_valid_moves(own, opp, (game->bits).mask) >> \
+                    bb_from_pos(pos, &game->board)) & 1;
+        case ENGINE_WIDE:
+            if (game->whoseTurn == 'O') {
+                wb_valid_moves(wide, wide->o, wide->x);
+            } else {
+                wb_valid_moves(wide, wide->x, wide->o);
+            }
+            return (wide->moves[pos >> 6] >> (pos & 63)) & 1;
+        case ENGINE_INCR:
+            return (game->validMove).s[pos] == game->whoseTurn;
+    }
+    return move_valid(pos, game->whoseTurn, &game->board);
+}
+
+int game_list_moves (gameType * game) {
+    /*
+        Write the cells of all valid moves for the current player to 
+            game->moveList; returns (& sets nMoves to) the count
+    */
+    int i, j, w, pos;
+    uint64_t own, opp, moves;
+    wideBoardType * wide = &game->wide;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    game->nMoves = 0;
+    /* bitboard engine: all moves at once, then list each one */
+    if (game->engine == ENGINE_BB64) {
+        own = (game->whoseTurn == 'O') ? (game->bits).o : (game->bits).x;
+        opp = (game->whoseTurn == 'O') ? (game->bits).x : (game->bits).o;
+        for (moves = bb_valid_moves(own, opp, (game->bits).mask); moves; \
+                moves &= moves - 1) {
+            (game->moveList)[(game->nMoves)++] = \
+                bb_to_pos(bb_first(moves), &game->board);
+        }
+    } else if (game->engine == ENGINE_WIDE) {
+        if (game->whoseTurn == 'O') {
+            wb_valid_moves(wide, wide->o, wide->x);
+        } else {
+            wb_valid_moves(wide, wide->x, wide->o);
+        }
+        for (w = 0; w < wide->words; w++) {
+            for (moves = wide->moves[w]; moves; moves &= moves - 1) {
+                (game->moveList)[(game->nMoves)++] = w*64 + bb_first(moves);
+            }
+        }
+    } else {
+        /* loop over all board positions */
+        for (i  = 0; i < (game->board).n; i++) {
+            for (j = 0; j < (game->board).n; j++) {
+                pos = BOARD_POS(&game->board, i, j);
+                if ((game->engine == ENGINE_INCR) ? \
+                        ((game->validMove).s[pos] == game->whoseTurn) : \
+                        move_valid(pos, game->whoseTurn, &game->board)) {
+                    (game->moveList)[(game->nMoves)++] = pos;
+                }
+            }
+        }
+    }
+    STATS_STOP(game, STATS_LIST, timer);
+    return game->nMoves;
+}
+
+void game_put_tile (int pos, gameType * game) {
+    /*
+        Execute a player's turn at a cell & place tiles appropriately
+    */
+    int i, w, dir;
+    char tile;
+    uint64_t * own, * opp, flips;
+    boardType * board = &game->board;
+    wideBoardType * wide = &game->wide;
+    STATS_TIMER(timer)
+    
+    /* Place centre tile */
+    STATS_START(timer);
+    tile = game->whoseTurn;
+    board->s[pos] = tile;
+    (game->changed)[0] = pos;
+    game->nChanged = 1;
+    game->empties--;
+    /* Bitboard engine: flip in both representations, one bit at a time */
+    if (game->engine == ENGINE_BB64) {
+        i = bb_from_pos(pos, board);
+        own = (tile == 'O') ? &(game->bits).o : &(game->bits).x;
+        opp = (tile == 'O') ? &(game->bits).x : &(game->bits).o;
+        flips = bb_flips(i, *own, *opp);
+        *own |= flips | (1ULL << i);
+        *opp &= ~flips;
+        while (flips) {
+            i = bb_to_pos(bb_first(flips), board);
+            board->s[i] = tile;
+            (game->changed)[game->nChanged++] = i;
+            flips &= flips - 1;
+        }
+    } else if (game->engine == ENGINE_WIDE) {
+        own = (tile == 'O') ? wide->o : wide->x;
+        opp = (tile == 'O') ? wide->x : wide->o;
+        wb_flips(pos, wide, own, opp);
+        own[pos >> 6] |= 1ULL << (pos & 63);
+        for (w = 0; w < wide->words; w++) {
+            own[w] |= wide->flips[w];
+            opp[w] &= ~(wide->flips[w]);
+            for (flips = wide->flips[w]; flips; flips &= flips - 1) {
+                i = w*64 + bb_first(flips);
+                board->s[i] = tile;
+                (game->changed)[game->nChanged++] = i;
+            }
+        }
+    } else {
+        /* Replace tiles now bounded by this players' pieces */
+        for (i = 0; i < 8; i++) {
+            dir = board->dir[i];
+            if (!board_walk(pos, dir, tile, board, WALK_VALIDATE)) {
+                continue;
+            }
+            for (w = pos + dir; board->s[w] != tile; w += dir) {
+                (game->changed)[game->nChanged++] = w;
+            }
+            board_walk(pos, dir, tile, board, WALK_REPLACE);
+        }
+    }
+    game_update_scores(game);
+    game_update_hash(game);
+    eval_update(pos, &(game->changed)[1], game->nChanged - 1, tile, 1, game);
+    if (game->engine == ENGINE_INCR) {
+        game_incr_update(game);
+    }
+    STATS_STOP(game, STATS_PUT, timer);
+}
+
+void game_update_scores (gameType * game) {
+    /*
+        Move the tiles changed by game_put_tile into the mover's score
+    */
+    int flips = game->nChanged - 1;
+    STATS_TIMER(timer)
+    
+    STATS_START(timer);
+    if (game->whoseTurn == 'O') {
+        game->scoreO += flips + 1;
+        game->scoreX -= flips;
+    } else {
+        game->scoreX += flips + 1;
+        game->scoreO -= flips;
+    }
+    STATS_STOP(game, STATS_SCORE, timer);
+}
+
+void game_update_hash (gameType * game) {
+    /*
+        Hash in the tiles changed by game_put_tile: the placed tile, and 
+            each flipped tile leaving the other player for the mover
+    */
+    int i, mover = (game->whoseTurn == 'X');
+    
+    game->hash ^= game->zobrist[2 * (game->changed)[0] + mover];
+    for (i = 1; i < game->nChanged; i++) {
+        game->hash ^= game->zobrist[2 * (game->changed)[i]] ^ \
+                      game->zobrist[2 * (game->changed)[i] + 1];
+    }
+}
+
+void game_hash_ini (gameType * game) {
+    /*
+        Make the random Zobrist keys for the board size (splitmix64 from 
+            a fixed seed, so keys match between runs) & hash the position
+    */
+    int i, cells = (game->board).stride * (game->board).stride;
+    uint64_t z, seed = ZOBRIST_SEED;
+    
+    game->zobrist = (uint64_t *) malloc(2 * cells * sizeof(uint64_t));
+    for (i = 0; i < 2 * cells; i++) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        game->zobrist[i] = z ^ (z >> 31);
+    }
+    game->hash = (game->whoseTurn == 'X') ? ZOBRIST_SIDE : 0;
+    for (i = 0; i < cells; i++) {
+        if ((game->board).s[i] == 'O') {
+            game->hash ^= game->zobrist[2*i];
+        } else if ((game->board).s[i] == 'X') {
+            game->hash ^= game->zobrist[2*i + 1];
+        }
+    }
+}
+
+void game_set_engine (gameType * game) {
+    /*
+        Pick the fastest move engine for the board size, or the one asked 
+            for if the board fits it, & load its state from the char array
+    */
+    int i, j;
+    bitboardType * bits = &game->bits;
+    
+    game_update_scoring(game);
+    game_lists_ini(game);
+    game_hash_ini(game);
+    game->book = book_open(game->bookPath, (game->board).n);
+    game->eval = eval_open(game->evalPath, &game->board);
+    eval_reset(game);
+    if ((game->board).n > WIDE_MAX_DIM) {
+        game->engine = ENGINE_INCR;
+    } else if ((game->board).n > BB64_MAX_DIM) {
+        game->engine = ENGINE_WIDE;
+    } else {
+        game->engine = ENGINE_BB64;
+    }
+    if ((game->engineOption == ENGINE_CHAR) || \
+        (game->engineOption == ENGINE_INCR) || \
+        ((game->engineOption == ENGINE_WIDE) && \
+         ((game->board).n <= WIDE_MAX_DIM)) || \
+        ((game->engineOption == ENGINE_BB64) && \
+         ((game->board).n <= BB64_MAX_DIM))) {
+        game->engine = game->engineOption;
+    }
+    
+    if (game->engine == ENGINE_INCR) {
+        game_incr_ini(game);
+        return;
+    }
+    if (game->engine == ENGINE_WIDE) {
+        wb_ini(&game->wide, &game->board);
+        return;
+    }
+    if (game->engine == ENGINE_CHAR) {
+        return;
+    }
+    bits->o = 0;
+    bits->x = 0;
+    bits->mask = 0;
+    for (i = 0; i < (game->board).n; i++) {
+        for (j = 0; j < (game->board).n; j++) {
+            bits->mask |= 1ULL << (i*8 + j);
+            if (CELL(&game->board, i, j) == 'O') {
+                bits->o |= 1ULL << (i*8 + j);
+            } else if (CELL(&game->board, i, j) == 'X') {
+                bits->x |= 1ULL << (i*8 + j);
+            }
+        }
+    }
+}
+
+void game_incr_ini (gameType * game) {
+    /*
+        Full scan of the valid moves for both players, as the starting
+            point for incremental updates
+    */
+    int i, j;
+    
+    board_ini(&game->validNext, (game->board).n);
+    board_cleanup(&game->validMove);
+    board_cleanup(&game->validNext);
+    game->nMoves = 0;
+    game->nMovesNext = 0;
+    for (i = 0; i < (game->board).n; i++) {
+        for (j = 0; j < (game->board).n; j++) {
+            game_incr_recheck(BOARD_POS(&game->board, i, j), game);
+        }
+    }
+}
+
+void game_incr_recheck (int pos, gameType * game) {
+    /*
+        Recompute whether the cell is a valid move for each player, keeping
+            the move counts in step. An occupied cell is never valid.
+    */
+    char other = (game->whoseTurn == 'O') ? 'X' : 'O';
+    char * now = &(game->validMove).s[pos], * next = &(game->validNext).s[pos];
+    
+    game->nMoves -= (*now != '.');
+    game->nMovesNext -= (*next != '.');
+    *now = move_valid(pos, game->whoseTurn, &game->board) ? game->whoseTurn : '.';
+    *next = move_valid(pos, other, &game->board) ? other : '.';
+    game->nMoves += (*now != '.');
+    game->nMovesNext += (*next != '.');
+}
+
+void game_incr_update (gameType * game) {
+    /*
+        Bring both players' valid moves up to date after game_put_tile.
+            A cell's validity only depends on the pieces along its paths 
+            up to the first empty cell, so only the empty cells reached by
+            walking out from a changed cell over occupied cells can change.
+            Each walk stops at the first empty cell, which is by 
+            construction on the frontier (next to an occupied cell).
+    */
+    int c, i, pos;
+    boardType * board = &game->board;
+    
+    /* the placed cell is no longer available to anyone */
+    game_incr_recheck((game->changed)[0], game);
+    for (c = 0; c < game->nChanged; c++) {
+        for (i = 0; i < 8; i++) {
+            pos = (game->changed)[c] + board->dir[i];
+            while ((board->s[pos] == 'O') || (board->s[pos] == 'X')) {
+                pos += board->dir[i];
+            }
+            if (board->s[pos] == '.') {
+                game_incr_recheck(pos, game);
+            }
+        }
+    }
+}
+
+void game_make_move (int pos, gameType * game) {
+    /*
+        Play a move for the current player, recording what it changed so 
+            game_unmake_move can take it back
+    */
+    undoType * undo = game_push_undo(pos, game);
+    undoStackType * stack = &game->undo;
+    
+    game_put_tile(pos, game);
+    /* keep the flipped cells (changed[0] is the placed tile) */
+    undo->nFlips = game->nChanged - 1;
+    if (stack->nFlips + undo->nFlips > stack->flipCapacity) {
+        stack->flipCapacity = 2 * (stack->nFlips + undo->nFlips);
+        stack->flips = (int *) realloc(stack->flips, \
+                                       stack->flipCapacity * sizeof(int));
+    }
+    memcpy(&stack->flips[stack->nFlips], &(game->changed)[1], \
+           undo->nFlips * sizeof(int));
+    stack->nFlips += undo->nFlips;
+    game_next_player(game);
+    game->passes = 0;
+}
+
+void game_make_pass (gameType * game) {
+    /*
+        Pass for the current player, recorded for game_unmake_move
+    */
+    game_push_undo(-1, game);
+    game_next_player(game);
+    game->passes++;
+}
+
+void game_unmake_move (gameType * game) {
+    /*
+        Take back the last move or pass from game_make_move/_pass, in 
+            time proportional to the tiles it flipped
+    */
+    undoStackType * stack = &game->undo;
+    undoType * undo = &stack->moves[--(stack->depth)];
+    boardType * board = &game->board;
+    wideBoardType * wide = &game->wide;
+    int i, bit, * flips;
+    char tile = undo->whoseTurn, other = (tile == 'O') ? 'X' : 'O';
+    uint64_t * own, * opp, mask;
+    
+    game_next_player(game);
+    game->passes = undo->passes;
+    if (undo->pos >= 0) {
+        stack->nFlips -= undo->nFlips;
+        flips = &stack->flips[stack->nFlips];
+        /* the char board */
+        board->s[undo->pos] = '.';
+        for (i = 0; i < undo->nFlips; i++) {
+            board->s[flips[i]] = other;
+        }
+        eval_update(undo->pos, flips, undo->nFlips, tile, -1, game);
+        /* the engine's own state */
+        if (game->engine == ENGINE_BB64) {
+            own = (tile == 'O') ? &(game->bits).o : &(game->bits).x;
+            opp = (tile == 'O') ? &(game->bits).x : &(game->bits).o;
+            mask = 0;
+            for (i = 0; i < undo->nFlips; i++) {
+                mask |= 1ULL << bb_from_pos(flips[i], board);
+            }
+            *opp |= mask;
+            *own &= ~(mask | (1ULL << bb_from_pos(undo->pos, board)));
+        } else if (game->engine == ENGINE_WIDE) {
+            own = (tile == 'O') ? wide->o : wide->x;
+            opp = (tile == 'O') ? wide->x : wide->o;
+            own[undo->pos >> 6] &= ~(1ULL << (undo->pos & 63));
+            for (i = 0; i < undo->nFlips; i++) {
+                bit = flips[i];
+                own[bit >> 6] &= ~(1ULL << (bit & 63));
+                opp[bit >> 6] |= 1ULL << (bit & 63);
+            }
+        } else if (game->engine == ENGINE_INCR) {
+            /* recheck around the same cells as the move did */
+            (game->changed)[0] = undo->pos;
+            memcpy(&(game->changed)[1], flips, undo->nFlips * sizeof(int));
+            game->nChanged = undo->nFlips + 1;
+            game_incr_update(game);
+        }
+    }
+    game->scoreO = undo->scoreO;
+    game->scoreX = undo->scoreX;
+    game->empties = undo->empties;
+    game->hash = undo->hash;
+    /* the incremental engine's counts were fixed by its rechecks */
+    if (game->engine != ENGINE_INCR) {
+        game->nMoves = undo->nMoves;
+        game->nMovesNext = undo->nMovesNext;
+    }
+}
+
+undoType * game_push_undo (int pos, gameType * game) {
+    /*
+        Record the counters & player before a move or pass at 'pos'
+    */
+    undoStackType * stack = &game->undo;
+    undoType * undo;
+    
+    if (stack->depth == stack->capacity) {
+        stack->capacity *= 2;
+        stack->moves = (undoType *) realloc(stack->moves, \
+                                            stack->capacity * sizeof(undoType));
+    }
+    undo = &stack->moves[(stack->depth)++];
+    undo->pos = pos;
+    undo->nFlips = 0;
+    undo->whoseTurn = game->whoseTurn;
+    undo->passes = game->passes;
+    undo->scoreO = game->scoreO;
+    undo->scoreX = game->scoreX;
+    undo->empties = game->empties;
+    undo->nMoves = game->nMoves;
+    undo->nMovesNext = game->nMovesNext;
+    undo->hash = game->hash;
+    return undo;
+}
+
+int bb_to_pos (int bit, boardType * board) {
+    /*
+        Return the board cell index of an 8x8 bitboard bit
+    */
+    return BOARD_POS(board, bit >> 3, bit & 7);
+}
+
+int bb_from_pos (int pos, boardType * board) {
+    /*
+        Return the 8x8 bitboard bit of a board cell index
+    */
+    return (pos / board->stride - 1) * 8 + pos % board->stride - 1;
+}
+
+uint64_t bb_shift (uint64_t b, int dir) {
+    /*
+        Move every bit one step along path 'dir', dropping bits which 
+            would wrap around a left/right edge
+    */
+    if (bbShift[dir] > 0) {
+        return (b << bbShift[dir]) & bbWrap[dir];
+    }
+    return (b >> -bbShift[dir]) & bbWrap[dir];
+}
+
+uint64_t bb_valid_moves (uint64_t own, uint64_t opp, uint64_t mask) {
+    /*
+        Return all valid moves for 'own': empty cells from which some path
+            crosses at least one 'opp' cell and ends on an 'own' cell.
+            Same rules as move_valid, for every cell at once.
+    */
+    int i, j;
+    uint64_t run, moves = 0, empty = mask & ~(own | opp);
+    
+    for (i = 0; i < 8; i++) {
+        /* grow runs of enemy pieces out of our own pieces (up to 6 long) */
+        run = bb_shift(own, i) & opp;
+        for (j = 0; j < BB64_MAX_DIM-3; j++) {
+            run |= bb_shift(run, i) & opp;
+        }
+        /* an empty cell at the end of a run is a move */
+        moves |= bb_shift(run, i) & empty;
+    }
+    return moves;
+}
+
+uint64_t bb_flips (int pos, uint64_t own, uint64_t opp) {
+    /*
+        Return the enemy pieces flipped by 'own' moving at bit 'pos'.
+            Same rules as board_walk: a path counts if it crosses enemy 
+            pieces and ends on one of ours before an empty cell or the edge.
+    */
+    int i;
+    uint64_t run, cell, flips = 0;
+    
+    for (i = 0; i < 8; i++) {
+        run = 0;
+        cell = bb_shift(1ULL << pos, i);
+        while (cell & opp) {
+            run |= cell;
+            cell = bb_shift(cell, i);
+        }
+        if (cell & own) {
+            flips |= run;
+        }
+    }
+    return flips;
+}
+
+int bb_first (uint64_t b) {
+    /*
+        Return the index of the lowest set bit (b must be nonzero)
+    */
+#ifdef __GNUC__
+    return __builtin_ctzll(b);
+#else
+    int i = 0;
+    while (!(b & 1)) {
+        b >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+int bb_count (uint64_t b) {
+    /*
+        Return the number of set bits
+    */
+#ifdef __GNUC__
+    return __builtin_popcountll(b);
+#else
+    int i = 0;
+    for (; b; b &= b - 1) {
+        i++;
+    }
+    return i;
+#endif
+}
+
+void wb_ini (wideBoardType * wide, boardType * board) {
+    /*
+        Allocate multi-word bitboards for the board & load its pieces
+    */
+    int i, j, pos;
+    uint64_t * mem;
+    
+    wb_kernel_ini();
+    wide->words = (board->stride * board->stride + 63) / 64;
+    for (wide->steps = 0; (1 << wide->steps) < board->n; wide->steps++);
+    for (i = 0; i < 8; i++) {
+        wide->shift[i] = board->dir[i];
+    }
+    /* one block for every bitboard */
+    mem = (uint64_t *) calloc(WIDE_BITBOARDS * wide->words, \
+                              sizeof(uint64_t));
+    wide->o = mem;
+    wide->x = mem + wide->words;
+    wide->mask = mem + 2*(wide->words);
+    wide->moves = mem + 3*(wide->words);
+    wide->flips = mem + 4*(wide->words);
+    wide->gen = mem + 5*(wide->words);
+    wide->pro = mem + 6*(wide->words);
+    wide->tmp = mem + 7*(wide->words);
+    wide->empty = mem + 8*(wide->words);
+    for (i = 0; i < board->n; i++) {
+        for (j = 0; j < board->n; j++) {
+            pos = BOARD_POS(board, i, j);
+            wide->mask[pos >> 6] |= 1ULL << (pos & 63);
+            if (board->s[pos] == 'O') {
+                wide->o[pos >> 6] |= 1ULL << (pos & 63);
+            } else if (board->s[pos] == 'X') {
+                wide->x[pos >> 6] |= 1ULL << (pos & 63);
+            }
+        }
+    }
+}
+
+void wb_valid_moves (wideBoardType * wide, uint64_t * own, uint64_t * opp) {
+    /*
+        Write all valid moves for 'own' to wide->moves. For each path, 
+            runs of enemy pieces are grown out of our own pieces by 
+            doubling the step each round (Kogge-Stone fill), so a whole 
+            board costs O(log n) shifts per path.
+    */
+    int i, j, w, step;
+    int words = wide->words;
+    uint64_t * gen = wide->gen, * pro = wide->pro, * tmp = wide->tmp;
+    
+    for (w = 0; w < words; w++) {
+        wide->empty[w] = wide->mask[w] & ~(own[w] | opp[w]);
+        wide->moves[w] = 0;
+    }
+    for (i = 0; i < 8; i++) {
+        /* gen: our pieces & enemy pieces reached from them so far 
+           pro: enemy pieces the next doubled step may cross */
+        memcpy(gen, own, words * sizeof(uint64_t));
+        memcpy(pro, opp, words * sizeof(uint64_t));
+        step = wide->shift[i];
+        for (j = 0; j < wide->steps; j++) {
+            wb_shift_and(tmp, gen, step, pro, words);
+            for (w = 0; w < words; w++) {
+                gen[w] |= tmp[w];
+            }
+            wb_shift_and(tmp, pro, step, pro, words);
+            memcpy(pro, tmp, words * sizeof(uint64_t));
+            step *= 2;
+        }
+        /* an empty cell at the end of a run is a move */
+        for (w = 0; w < words; w++) {
+            gen[w] &= opp[w];
+        }
+        wb_shift_and(tmp, gen, wide->shift[i], wide->empty, words);
+        for (w = 0; w < words; w++) {
+            wide->moves[w] |= tmp[w];
+        }
+    }
+}
+
+void wb_flips (int pos, wideBoardType * wide, uint64_t * own, uint64_t * opp) {
+    /*
+        Write the enemy pieces flipped by 'own' moving at bit 'pos' to 
+            wide->flips, using the same rules as bb_flips. Edge ring bits
+            are never set, so every walk stops inside the bitboard.
+    */
+    int i, cell, run;
+    
+    memset(wide->flips, 0, wide->words * sizeof(uint64_t));
+    for (i = 0; i < 8; i++) {
+        /* walk the path while it crosses enemy pieces */
+        cell = pos + wide->shift[i];
+        while ((opp[cell >> 6] >> (cell & 63)) & 1) {
+            cell += wide->shift[i];
+        }
+        if (!((own[cell >> 6] >> (cell & 63)) & 1)) {
+            continue;
+        }
+        /* ended on our own piece: mark the run */
+        for (run = pos + wide->shift[i]; run != cell; run += wide->shift[i]) {
+            wide->flips[run >> 6] |= 1ULL << (run & 63);
+        }
+    }
+}
+
+void wb_kernel_ini (void) {
+    /*
+        Pick the shift kernel once, even with games made on many threads
+    */
+    pthread_once(&wbKernelOnce, wb_kernel_pick);
+}
+
+void wb_kernel_pick (void) {
+    /*
+        Pick the widest shift kernel the CPU supports
+    */
+    wb_shift_and = wb_shift_and_scalar;
+#ifdef WIDE_X86
+#ifdef __SSE2__
+    wb_shift_and = wb_shift_and_sse2;
+#endif
+    if (__builtin_cpu_supports("avx2")) {
+        wb_shift_and = wb_shift_and_avx2;
+    }
+#endif
+}
+
+void wb_shift_and_range (uint64_t * dst, const uint64_t * src, int shift, \
+                         const uint64_t * and, int from, int to, int words) {
+    /*
+        dst = (src shifted by 'shift' bits) & and, for words [from, to).
+            A positive shift moves bits towards higher cell numbers; bits 
+            shifted in from outside src are zero.
+    */
+    int i, j, q, r;
+    uint64_t hi, lo;
+    
+    q = (shift < 0 ? -shift : shift) >> 6;
+    r = (shift < 0 ? -shift : shift) & 63;
+    for (i = from; i < to; i++) {
+        if (shift >= 0) {
+            /* word i takes the top of word i-q-1 & the bottom of i-q */
+            j = i - q;
+            hi = ((j >= 0) && (j < words)) ? src[j] : 0;
+            lo = ((j >= 1) && (j <= words)) ? src[j-1] : 0;
+            dst[i] = ((hi << r) | (r ? lo >> (64-r) : 0)) & and[i];
+        } else {
+            /* word i takes the top of word i+q & the bottom of i+q+1 */
+            j = i + q;
+            lo = ((j >= 0) && (j < words)) ? src[j] : 0;
+            hi = ((j >= -1) && (j < words-1)) ? src[j+1] : 0;
+            dst[i] = ((lo >> r) | (r ? hi << (64-r) : 0)) & and[i];
+        }
+    }
+}
+
+void wb_shift_and_scalar (uint64_t * dst, const uint64_t * src, int shift, \
+                          const uint64_t * and, int words) {
+    /*
+        Portable shift kernel
+    */
+    wb_shift_and_range(dst, src, shift, and, 0, words, words);
+}
+
+#ifdef WIDE_X86
+#ifdef __SSE2__
+void wb_shift_and_sse2 (uint64_t * dst, const uint64_t * src, int shift, \
+                        const uint64_t * and, int words) {
+    /*
+        Shift kernel, 2 words at a time. Words whose source words fall 
+            off either end of src are left to the portable kernel.
+    */
+    int i, q, r, from, to;
+    __m128i a, b, countA, countB;
+    
+    q = (shift < 0 ? -shift : shift) >> 6;
+    r = (shift < 0 ? -shift : shift) & 63;
+    /* SSE2 shifts by 64 give zero, which handles r == 0 */
+    countA = _mm_cvtsi32_si128(r);
+    countB = _mm_cvtsi32_si128(64 - r);
+    from = (shift >= 0) ? q + 1 : 0;
+    from = (from < words) ? from : words;
+    to = (shift >= 0) ? words : words - q - 1;
+    for (i = from; i + 2 <= to; i += 2) {
+        if (shift >= 0) {
+            a = _mm_loadu_si128((const __m128i *) (src + i - q));
+            b = _mm_loadu_si128((const __m128i *) (src + i - q - 1));
+            a = _mm_or_si128(_mm_sll_epi64(a, countA), \
+                             _mm_srl_epi64(b, countB));
+        } else {
+            a = _mm_loadu_si128((const __m128i *) (src + i + q));
+            b = _mm_loadu_si128((const __m128i *) (src + i + q + 1));
+            a = _mm_or_si128(_mm_srl_epi64(a, countA), \
+                             _mm_sll_epi64(b, countB));
+        }
+        a = _mm_and_si128(a, _mm_loadu_si128((const __m128i *) (and + i)));
+        _mm_storeu_si128((__m128i *) (dst + i), a);
+    }
+    if (i < from) {
+        i = from;
+    }
+    wb_shift_and_range(dst, src, shift, and, 0, from, words);
+    wb_shift_and_range(dst, src, shift, and, i, words, words);
+}
+#endif
+
+__attribute__((target("avx2")))
+void wb_shift_and_avx2 (uint64_t * dst, const uint64_t * src, int shift, \
+                        const uint64_t * and, int words) {
+    /*
+        Shift kernel, 4 words at a time (see wb_shift_and_sse2)
+    */
+    int i, q, r, from, to;
+    __m256i a, b;
+    __m128i countA, countB;
+    
+    q = (shift < 0 ? -shift : shift) >> 6;
+    r = (shift < 0 ? -shift : shift) & 63;
+    countA = _mm_cvtsi32_si128(r);
+    countB = _mm_cvtsi32_si128(64 - r);
+    from = (shift >= 0) ? q + 1 : 0;
+    from = (from < words) ? from : words;
+    to = (shift >= 0) ? words : words - q - 1;
+    for (i = from; i + 4 <= to; i += 4) {
+        if (shift >= 0) {
+            a = _mm256_loadu_si256((const __m256i *) (src + i - q));
+            b = _mm256_loadu_si256((const __m256i *) (src + i - q - 1));
+            a = _mm256_or_si256(_mm256_sll_epi64(a, countA), \
+                                _mm256_srl_epi64(b, countB));
+        } else {
+            a = _mm256_loadu_si256((const __m256i *) (src + i + q));
+            b = _mm256_loadu_si256((const __m256i *) (src + i + q + 1));
+            a = _mm256_or_si256(_mm256_srl_epi64(a, countA), \
+                                _mm256_sll_epi64(b, countB));
+        }
+        a = _mm256_and_si256(a, \
+                _mm256_loadu_si256((const __m256i *) (and + i)));
+        _mm256_storeu_si256((__m256i *) (dst + i), a);
+    }
+    if (i < from) {
+        i = from;
+    }
+    wb_shift_and_range(dst, src, shift, and, 0, from, words);
+    wb_shift_and_range(dst, src, shift, and, i, words, words);
+}
+#endif
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Game state, memory management and R/W */
+
+void game_ini (gameType * game) {
+    /* 
+        Apply initial game state; board unchanged
+    */
+    game->scoreO = 0;
+    game->scoreX = 0;
+    game->pTypeO = -1;
+    game->pTypeX = -1;
+    game->whoseTurn = 'O';
+    game->filepath = (char *) malloc(sizeof(char));
+    game->filepath[0] = '\0';
+    game->passes = 0;
+    game->engine = ENGINE_CHAR;
+    game->engineOption = -1;
+    (game->limits).depth = 0;
+    (game->limits).timeMs = SEARCH_TIME_MS;
+    (game->limits).nodes = 0;
+    (game->limits).deadlineMs = 0;
+    memset(&game->deadline, 0, sizeof(deadlineStatsType));
+    game->ttMb = TT_DEFAULT_MB;
+    game->threads = 1;
+    game->endgame = ENDGAME_EMPTIES;
+    game->abort = NULL;
+    game->ponderHash = 0;
+    game->ponderSeconds = 0;
+    (game->lastSearch).reply = -1;
+    game->bookPath = NULL;
+    game->evalPath = NULL;
+    game->eval = NULL;
+    game->book = NULL;
+#ifdef FLIP_STATS
+    memset(&game->stats, 0, sizeof(statsType));
+#endif
+    game->tt = NULL;
+    game->zobrist = NULL;
+    game->hash = 0;
+    game->isClone = 0;
+}
+
+void game_set_fname (char * fname, gameType *game) {
+    /* 
+        Set the referrable filepath for load, save & sysMessage
+    */
+    free(game->filepath);
+    game->filepath = (char *) malloc((strlen(fname)+1) * sizeof(char));
+    game->filepath[strlen(fname)] = '\0';
+    strcpy(game->filepath, fname);
+}
+
+int game_load (char * fname, gameType * game) {
+    /*
+        Try to load & apply a gamestate from a save file of either 
+            version, reading it through mmap. Assumes gameplay has not yet 
+            started. Returns FLIP_OK, or FLIP_ERR_LOAD with the game left 
+            without boards.
+    */
+    struct stat info;
+    unsigned char * map;
+    int fd, result;
+    game_set_fname(fname, game);
+    
+    /* Check file readable */
+    if (strlen(fname) == 0) {
+        return FLIP_ERR_LOAD;
+    }
+    fd = open(fname, O_RDONLY);
+    if (fd < 0) {
+        return FLIP_ERR_LOAD;
+    }
+    if ((fstat(fd, &info) != 0) || (info.st_size < strlen(PROG_NAME))) {
+        close(fd);
+        return FLIP_ERR_LOAD;
+    }
+    map = (unsigned char *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+                                 fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return FLIP_ERR_LOAD;
+    }
+    if ((info.st_size >= SAVE_HEADER) && !memcmp(map, SAVE_MAGIC, 8)) {
+        result = game_load_packed(map, info.st_size, game);
+    } else {
+        result = game_load_legacy(map, info.st_size, game);
+    }
+    munmap(map, info.st_size);
+    if (result == FLIP_OK) {
+        game_set_engine(game);
+    }
+    return result;
+}
+
+int game_load_packed (unsigned char * data, size_t size, gameType * game) {
+    /*
+        Apply a version 2 save file:
+ 
+        0   SAVE_MAGIC
+        8   version
+        12  board.n
+        16  whoseTurn, passes, pTypeO, pTypeX (a byte each)
+        20  checksum of everything else
+        24  cells, 2 bits each
+    */
+    unsigned int i, n, cells;
+    uint32_t sum;
+    unsigned char code, * packed = data + SAVE_HEADER;
+    char * row, * unpacked, * decode;
+    const char tile[4] = { '.', 'O', 'X', 0 };
+    
+    n = save_get32(data + 12);
+    if ((save_get32(data + 8) != SAVE_VERSION) || (n <= 3) || \
+        (n > BOARD_MAX_DIM) || ((data[16] != 'O') && (data[16] != 'X'))) {
+        return FLIP_ERR_LOAD;
+    }
+    cells = n * n;
+    sum = save_checksum(data, 20) ^ save_checksum(packed, (cells + 3) / 4);
+    if ((size != SAVE_HEADER + (cells + 3) / 4) || \
+        (sum != save_get32(data + 20))) {
+        return FLIP_ERR_LOAD;
+    }
+    /* the checksum only catches damage, not a file made to be wrong */
+    if ((data[17] > 2) || (data[18] > PLAYER_TYPE_MAX) || \
+        (data[19] > PLAYER_TYPE_MAX)) {
+        return FLIP_ERR_LOAD;
+    }
+    game->whoseTurn = data[16];
+    game->passes = data[17];
+    game->pTypeO = data[18];
+    game->pTypeX = data[19];
+    
+    /* unpack a byte (4 cells) at a time from a table of every byte */
+    decode = (char *) malloc(256 * 4);
+    for (i = 0; i < 256 * 4; i++) {
+        decode[i] = tile[(i / 4 >> (2 * (i % 4))) & 3];
+    }
+    unpacked = (char *) malloc(cells + 3);
+    for (i = 0; i < (cells + 3) / 4; i++) {
+        memcpy(&unpacked[4*i], &decode[4 * packed[i]], 4);
+    }
+    free(decode);
+    if (memchr(unpacked, 0, cells) != NULL) {
+        free(unpacked);
+        return FLIP_ERR_LOAD;
+    }
+    /* both tried, so both can be freed */
+    if (!board_ini(&game->board, n) | !board_ini(&game->validMove, n)) {
+        board_free(&game->board);
+        board_free(&game->validMove);
+        free(unpacked);
+        return FLIP_ERR_LOAD;
+    }
+    for (i = 0, row = unpacked; i < n; i++, row += n) {
+        memcpy(&CELL(&game->board, i, 0), row, n);
+    }
+    free(unpacked);
+    /* unused bits after the last cell must be clear */
+    code = (cells % 4) ? packed[cells / 4] >> (2 * (cells % 4)) : 0;
+    if (code != 0) {
+        board_free(&game->board);
+        board_free(&game->validMove);
+        return FLIP_ERR_LOAD;
+    }
+    return FLIP_OK;
+}
+
+int game_load_legacy (unsigned char * data, size_t size, gameType * game) {
+    /*
+        Apply a version 1 save file, written on a machine with the same 
+            int size & byte order:
+ 
+        'flip'
+        passes
+        pType1
+        pType2
+        whoseTurn
+        board.n
+        board.s[0]
+        ...
+        board.s[n-1]
+    */
+    size_t at = strlen(PROG_NAME);
+    unsigned int i, n;
+    
+    if ((size < at + 4 * sizeof(int) + 1) || \
+        memcmp(data, PROG_NAME, strlen(PROG_NAME))) {
+        return FLIP_ERR_LOAD;
+    }
+    memcpy(&game->passes, data + at, sizeof(int));
+    memcpy(&game->pTypeO, data + at + sizeof(int), sizeof(int));
+    memcpy(&game->pTypeX, data + at + 2 * sizeof(int), sizeof(int));
+    game->whoseTurn = data[at + 3 * sizeof(int)];
+    memcpy(&n, data + at + 3 * sizeof(int) + 1, sizeof(int));
+    at += 4 * sizeof(int) + 1;
+    if ((n <= 3) || (n > BOARD_MAX_DIM) || (size < at + (size_t) n * n) || \
+        ((game->whoseTurn != 'O') && (game->whoseTurn != 'X')) || \
+        (game->passes < 0) || (game->passes > 2) || \
+        (game->pTypeO < 0) || (game->pTypeO > PLAYER_TYPE_MAX) || \
+        (game->pTypeX < 0) || (game->pTypeX > PLAYER_TYPE_MAX)) {
+        return FLIP_ERR_LOAD;
+    }
+    /* board/validMove state */
+    /* both tried, so both can be freed */
+    if (!board_ini(&game->board, n) | !board_ini(&game->validMove, n)) {
+        board_free(&game->board);
+        board_free(&game->validMove);
+        return FLIP_ERR_LOAD;
+    }
+    for (i = 0; i < n; i++, at += n) {
+        memcpy(&CELL(&game->board, i, 0), data + at, n);
+    }
+    return FLIP_OK;
+}
+
+int game_save (char * fname, gameType * game) {
+/*
+    Try to write state-dependent parts of '*game' to file, in the packed
+        format read by game_load_packed; returns FLIP_OK, FLIP_ERR_NAME or
+        FLIP_ERR_SAVE
+*/
+    FILE * f;
+    unsigned int i, k, n = (game->board).n, cells = n * n;
+    unsigned char header[SAVE_HEADER], * packed;
+    char * row;
+    bool ok;
+    game_set_fname(fname, game);
+    
+    /* Check file writable */
+    if (strlen(fname) == 0) {
+        return FLIP_ERR_NAME;
+    }
+    f = fopen(fname, "wb");
+    if (f == NULL) {
+        return FLIP_ERR_SAVE;
+    }
+    /* Pack the board, then make the header */
+    packed = (unsigned char *) calloc((cells + 3) / 4, 1);
+    for (i = 0, k = 0; i < n; i++) {
+        for (row = &CELL(&game->board, i, 0); row < &CELL(&game->board, i, n); 
+                row++, k++) {
+            packed[k / 4] |= ((*row == 'O') ? 1 : (*row == 'X') ? 2 : 0) \
+                             << (2 * (k % 4));
+        }
+    }
+    memcpy(header, SAVE_MAGIC, 8);
+    save_put32(header + 8, SAVE_VERSION);
+    save_put32(header + 12, n);
+    header[16] = game->whoseTurn;
+    header[17] = game->passes;
+    header[18] = game->pTypeO;
+    header[19] = game->pTypeX;
+    save_put32(header + 20, save_checksum(header, 20) ^ \
+                            save_checksum(packed, (cells + 3) / 4));
+    ok = (fwrite(header, 1, SAVE_HEADER, f) == SAVE_HEADER) && \
+         (fwrite(packed, 1, (cells + 3) / 4, f) == (cells + 3) / 4);
+    free(packed);
+    if ((fclose(f) != 0) || !ok) {
+        return FLIP_ERR_SAVE;
+    }
+    return FLIP_OK;
+}
+
+uint32_t save_checksum (unsigned char * data, size_t size) {
+    /*
+        FNV-1a hash of the bytes
+    */
+    uint32_t hash = 2166136261U;
+    size_t i;
+    
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return hash;
+}
+
+void save_put32 (unsigned char * p, uint32_t value) {
+    /*
+        Write a value as 4 little-endian bytes
+    */
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+uint32_t save_get32 (unsigned char * p) {
+    /*
+        Read 4 little-endian bytes
+    */
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+FILE * save_replace_open (char * fname, char ** tmp) {
+    /*
+        Open a file to be written in place of 'fname': the name with 
+            ".tmp" added, returned in *tmp for save_replace_close
+    */
+    *tmp = (char *) malloc(strlen(fname) + 5);
+    sprintf(*tmp, "%s.tmp", fname);
+    return fopen(*tmp, "wb");
+}
+
+int save_replace_close (FILE * f, char * tmp, char * fname, bool ok) {
+    /*
+        Finish a file from save_replace_open: if it was all written, 
+            rename it over 'fname', so anyone with the old file mapped 
+            keeps it whole, else remove it. Returns FLIP_OK or 
+            FLIP_ERR_SAVE.
+    */
+    if (f != NULL) {
+        ok = (fclose(f) == 0) && ok && (rename(tmp, fname) == 0);
+        if (!ok) {
+            remove(tmp);
+        }
+    }
+    free(tmp);
+    return ((f != NULL) && ok) ? FLIP_OK : FLIP_ERR_SAVE;
+}
+
+void game_next_player (gameType * game) {
+    /*
+        Swap players
+    */
+    boardType swap;
+    int count;
+    
+    /* incremental engine: the other player's moves are already known */
+    if (game->engine == ENGINE_INCR) {
+        swap = game->validMove;
+        game->validMove = game->validNext;
+        game->validNext = swap;
+        count = game->nMoves;
+        game->nMoves = game->nMovesNext;
+        game->nMovesNext = count;
+    }
+    if (game->whoseTurn == 'X') {
+        game->whoseTurn = 'O';
+    } else {
+        game->whoseTurn = 'X';
+    }   
+    game->hash ^= ZOBRIST_SIDE;
+}
+
+void game_update_scoring (gameType * game) {
+    /* 
+        Count the score & empty cells into the game struct
+    */
+    int i, j;
+    game->scoreO = 0;
+    game->scoreX = 0;
+    game->empties = 0;
+    /* Loop over board */
+    for (i = 0; i < (game->board).n; i++) {
+        for (j = 0; j < (game->board).n; j++) {
+            /* Increment player 1/2 score */
+            switch ( CELL(&game->board, i, j) ) {
+                case 'O':
+                    game->scoreO++;
+                    break;
+                case 'X':
+                    game->scoreX++;
+                    break;
+                case '.':
+                    game->empties++;
+                    break;
+            }
+        }
+    }
+}
+
+void game_lists_ini (gameType * game) {
+    /*
+        Allocate the per-move working lists for the game's board size
+    */
+    int n = (game->board).n;
+    
+    /* room for a placed tile & up to n-2 flips along each path */
+    game->changed = (int *) malloc( (8 * n + 1) * sizeof(int) );
+    game->nChanged = 0;
+    game->moveList = (int *) malloc( n * n * sizeof(int) );
+    /* enough for a typical search; grown if ever needed */
+    (game->undo).depth = 0;
+    (game->undo).capacity = SEARCH_MAX_PLY;
+    (game->undo).moves = (undoType *) malloc( SEARCH_MAX_PLY * \
+                                              sizeof(undoType) );
+    (game->undo).nFlips = 0;
+    (game->undo).flipCapacity = SEARCH_MAX_PLY * n;
+    (game->undo).flips = (int *) malloc( SEARCH_MAX_PLY * n * sizeof(int) );
+}
+
+void game_clone (gameType * dst, gameType * src) {
+    /*
+        Allocate a private copy of a game in play, with the same engine.
+            The copy doesn't own a filepath, and shares the original's
+            Zobrist keys & transposition table.
+    */
+    int n = (src->board).n;
+    
+    board_ini(&dst->board, n);
+    board_ini(&dst->validMove, n);
+    if (src->engine == ENGINE_INCR) {
+        board_ini(&dst->validNext, n);
+    }
+    if (src->engine == ENGINE_WIDE) {
+        wb_ini(&dst->wide, &src->board);
+    }
+    game_lists_ini(dst);
+    memset(&dst->deadline, 0, sizeof(deadlineStatsType));
+#ifdef FLIP_STATS
+    memset(&dst->stats, 0, sizeof(statsType));
+#endif
+    game_copy(dst, src);
+}
+
+void game_copy (gameType * dst, gameType * src) {
+    /*
+        Overwrite a clone (from game_clone) with the state of 'src'
+    */
+    gameType keep = *dst;
+    int cells = (src->board).stride * (src->board).stride;
+    
+    *dst = *src;
+    dst->filepath = NULL;
+    dst->isClone = 1;
+    /* keep the clone's own memory, but fill it from src */
+    (dst->board).s = keep.board.s;
+    (dst->validMove).s = keep.validMove.s;
+    (dst->validNext).s = keep.validNext.s;
+    dst->wide = keep.wide;
+    dst->changed = keep.changed;
+    dst->moveList = keep.moveList;
+    dst->undo = keep.undo;
+    /* as does its own time against the deadline */
+    dst->deadline = keep.deadline;
+#ifdef FLIP_STATS
+    /* a clone counts its own work */
+    dst->stats = keep.stats;
+#endif
+    (dst->undo).depth = 0;
+    (dst->undo).nFlips = 0;
+    memcpy((dst->board).s, (src->board).s, cells);
+    memcpy((dst->validMove).s, (src->validMove).s, cells);
+    if (src->engine == ENGINE_INCR) {
+        memcpy((dst->validNext).s, (src->validNext).s, cells);
+    }
+    if (src->engine == ENGINE_WIDE) {
+        /* o & x are next to each other in the block */
+        memcpy((dst->wide).o, (src->wide).o, \
+               2 * (src->wide).words * sizeof(uint64_t));
+    }
+    memcpy(dst->changed, src->changed, src->nChanged * sizeof(int));
+}
+
+void game_free (gameType * game) {
+    /*
+        Clear memory used by a game's boards & engine
+    */
+    board_free(&game->board);
+    board_free(&game->validMove);
+    if (game->engine == ENGINE_INCR) {
+        board_free(&game->validNext);
+    }
+    if (game->engine == ENGINE_WIDE) {
+        free((game->wide).o);
+    }
+    free(game->changed);
+    free(game->moveList);
+    free((game->undo).moves);
+    free((game->undo).flips);
+    free(game->filepath);
+    if (!game->isClone) {
+        free(game->zobrist);
+        tt_free(game->tt);
+        book_close(game->book);
+        eval_close(game->eval);
+    }
+}
+
+bool board_ini (boardType * board, unsigned int size) {
+    /* 
+        Allocate memory for the board & write default values; returns 0 
+            (with no board) if there isn't the memory. Sizes are up to 
+            BOARD_MAX_DIM.
+    */
+    int i, d, midPos;
+    board->n = size;
+    board->stride = size + 2;
+    /* one block: edge ring all round, empty cells inside */
+    board->s = (char *) malloc( (size_t) board->stride * board->stride );
+    if (board->s == NULL) {
+        return 0;
+    }
+    memset( board->s, BOARD_EDGE, (size_t) board->stride * board->stride );
+    board_cleanup(board);
+    /* cell offsets for the 8 paths from a tile: every (dx,dy) in a 3x3 
+       block except (0,0) */
+    for (i = 0, d = 0; d < 9; d++) {
+        if (d != 4) {
+            board->dir[i++] = (d/3 - 1) * board->stride + (d%3 - 1);
+        }
+    }
+    /* put starting positions on the board */
+    midPos = (board->n - 1)/2;
+    CELL(board, midPos, midPos) = 'O';
+    CELL(board, midPos+1, midPos) = 'X';
+    CELL(board, midPos, midPos+1) = 'X';
+    CELL(board, midPos+1, midPos+1) = 'O';
+    return 1;
+}
+
+void board_cleanup (boardType * board) {
+    /*
+        Writes '.' characters to the entire board
+    */
+    int i;
+    for (i = 0; i < (board->n); i++) {
+        memset( &CELL(board, i, 0), '.', (board->n) * sizeof(char) );
+    }
+}
+
+bool board_missing_char (char c, boardType * board) {
+    /*
+        Return whether there are no free spots remaining
+    */
+    int i, j;
+    for (i = 0; i < (board->n); i++) {
+        for (j = 0; j < (board->n); j++) {
+            if (CELL(board, i, j) == c) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void board_free (boardType * board) {
+    /* 
+     Clear memory used by board 
+     */
+    free(board->s);
+}
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Profiling counters */
+
+#ifdef FLIP_STATS
+uint64_t stats_clock (void) {
+    /*
+        Return a fine-grained timestamp: the CPU's cycle counter where 
+            there is one, else nanoseconds
+    */
+#ifdef WIDE_X86
+    return __rdtsc();
+#else
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+void stats_merge (statsType * dst, statsType * src) {
+    /*
+        Add one set of counters into another
+    */
+    int i;
+    
+    for (i = 0; i < STATS_ROWS; i++) {
+        dst->calls[i] += src->calls[i];
+        dst->cycles[i] += src->cycles[i];
+    }
+    dst->nodes += src->nodes;
+    dst->cutoffs += src->cutoffs;
+    dst->ttProbes += src->ttProbes;
+    dst->ttHits += src->ttHits;
+}
+#endif
+
+
+/* ------------------------------------------------------------------------- */
+
+/* Game handle API */
+
+gameType * flip_new (int dim, int * err) {
+    /*
+        Start a new game on a dim x dim board, with O to move. Returns the 
+            game, or NULL with *err set.
+    */
+    gameType * game;
+    
+    if ((dim <= 3) || (dim > BOARD_MAX_DIM)) {
+        *err = FLIP_ERR_DIM;
+        return NULL;
+    }
+    game = (gameType *) malloc(sizeof(gameType));
+    game_ini(game);
+    board_ini(&game->board, dim);
+    board_ini(&game->validMove, dim);
+    game_set_engine(game);
+    *err = FLIP_OK;
+    return game;
+}
+
+gameType * flip_load (char * fname, int * err) {
+    /*
+        Continue a saved game. Returns the game, or NULL with *err set.
+    */
+    gameType * game = (gameType *) malloc(sizeof(gameType));
+    
+    game_ini(game);
+    *err = game_load(fname, game);
+    if (*err != FLIP_OK) {
+        free(game->filepath);
+        free(game);
+        return NULL;
+    }
+    return game;
+}
+
+void flip_destroy (gameType * game) {
+    /*
+        Free a game from flip_new or flip_load
+    */
+    game_free(game);
+    free(game);
+}
+
+int flip_move (gameType * game, int x, int y) {
+    /*
+        Play at (x,y) for the player to move; returns FLIP_OK, or 
+            FLIP_ERR_MOVE & leaves the game as it was
+    */
+    int i, pos, n = (game->board).n;
+    
+    if ((x < 0) || (y < 0) || (x >= n) || (y >= n)) {
+        return FLIP_ERR_MOVE;
+    }
+    pos = BOARD_POS(&game->board, x, y);
+    game_list_moves(game);
+    for (i = 0; i < game->nMoves; i++) {
+        if ((game->moveList)[i] == pos) {
+            game_put_tile(pos, game);
+            game_next_player(game);
+            game->passes = 0;
+            return FLIP_OK;
+        }
+    }
+    return FLIP_ERR_MOVE;
+}
+
+int flip_pass (gameType * game) {
+    /*
+        Pass for the player to move, only allowed when they have no valid 
+            move; returns FLIP_OK or FLIP_ERR_MOVE
+    */
+    if ((flip_status(game) != GAME_ON) || (game_list_moves(game) > 0)) {
+        return FLIP_ERR_MOVE;
+    }
+    game_next_player(game);
+    game->passes++;
+    return FLIP_OK;
+}
+
+int flip_ai_move (gameType * game, int playerType) {
+    /*
+        Let an AI type move (or pass) for the player to move; returns 
+            FLIP_OK, FLIP_ERR_TYPE, or FLIP_ERR_MOVE if the game is over
+    */
+    int pos;
+    
+    if ((playerType < AI_FORWARD) || (playerType > PLAYER_TYPE_MAX)) {
+        return FLIP_ERR_TYPE;
+    }
+    if ((game->empties == 0) || (game->passes > 1)) {
+        return FLIP_ERR_MOVE;
+    }
+    game_update_valid_moves(game);
+    if (game->nMoves == 0) {
+        return flip_pass(game);
+    }
+    pos = ai_choose(playerType, game);
+    game_put_tile(pos, game);
+    game_next_player(game);
+    game->passes = 0;
+    return FLIP_OK;
+}
+
+int flip_legal_moves (gameType * game, intPair * moves) {
+    /*
+        Return the number of valid moves for the player to move, writing 
+            their (x,y) to 'moves' (room for dim*dim) unless it is NULL
+    */
+    int i;
+    
+    game_list_moves(game);
+    for (i = 0; moves && (i < game->nMoves); i++) {
+        moves[i].a = (game->moveList)[i] / (game->board).stride - 1;
+        moves[i].b = (game->moveList)[i] % (game->board).stride - 1;
+    }
+    return game->nMoves;
+}
+
+void flip_score (gameType * game, int * scoreO, int * scoreX) {
+    /*
+        Read the number of tiles each player holds
+    */
+    *scoreO = game->scoreO;
+    *scoreX = game->scoreX;
+}
+
+int flip_status (gameType * game) {
+    /*
+        Return GAME_ON, or how the game ended: a full board, or neither 
+            player able to move
+    */
+    int next;
+    
+    if (game->empties == 0) {
+        return GAME_FULL;
+    }
+    if (game->passes > 1) {
+        return GAME_BLOCKED;
+    }
+    if (game_list_moves(game) > 0) {
+        return GAME_ON;
+    }
+    /* no move: the game is over if the other player has none either */
+    game_make_pass(game);
+    next = game_list_moves(game);
+    game_unmake_move(game);
+    return (next > 0) ? GAME_ON : GAME_BLOCKED;
+}
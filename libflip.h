@@ -0,0 +1,55 @@
+/* Flip engine: the game handle API. Games are made, played & queried 
+    only through these calls, which report errors as FLIP_ERR_* codes; 
+    nothing here exits or prints. The engine's internals are in 
+    libflip_private.h, for its own front end. */
+
+#ifndef LIBFLIP_H
+#define LIBFLIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Player types */
+#define AI_FORWARD 1    /* first valid cell, scanning forwards */
+#define AI_BACKWARD 2   /* first valid cell, scanning backwards */
+#define AI_SEARCH 3     /* alpha-beta search */
+#define AI_MCTS 4       /* Monte Carlo tree search */
+#define PLAYER_TYPE_MAX 4
+/* Return codes from the game API & save files */
+#define FLIP_OK 0
+#define FLIP_ERR_DIM -1     /* board size not over 3, or too big */
+#define FLIP_ERR_MOVE -2    /* not a valid move for the player to move */
+#define FLIP_ERR_LOAD -3    /* missing or invalid save file */
+#define FLIP_ERR_SAVE -4    /* unable to write the save file */
+#define FLIP_ERR_NAME -5    /* no filename given */
+#define FLIP_ERR_TYPE -6    /* not an AI player type */
+/* Game status, numbered as the sysMessage IDs announcing the end */
+#define GAME_ON 0
+#define GAME_FULL 2
+#define GAME_BLOCKED 3
+
+/* Game state, opaque outside the engine */
+typedef struct gameType gameType;
+
+/* Integer pair */
+typedef struct {
+    int a, b;
+} intPair;
+
+/* Game handle API */
+gameType * flip_new (int dim, int * err);
+gameType * flip_load (char * fname, int * err);
+void flip_destroy (gameType * game);
+int flip_move (gameType * game, int x, int y);
+int flip_pass (gameType * game);
+int flip_ai_move (gameType * game, int playerType);
+int flip_legal_moves (gameType * game, intPair * moves);
+void flip_score (gameType * game, int * scoreO, int * scoreX);
+int flip_status (gameType * game);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,594 @@
+/* Flip engine internals: boards, move engines, AI players & the full 
+    game state, for libflip.c & the flip front end. Not installed; 
+    embedders use the handle API in libflip.h. Nothing here exits or 
+    prints, except tt_report to stderr. */
+
+#ifndef LIBFLIP_PRIVATE_H
+#define LIBFLIP_PRIVATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "libflip.h"
+
+#define PROG_NAME "flip"
+/* Save files: a little-endian header, then 2 bits per cell (0 empty, 
+    1 O, 2 X), 4 cells a byte, row by row. Version 1 is the old format:
+    PROG_NAME, then native ints & one byte per cell. */
+#define SAVE_MAGIC "flipsave"
+#define SAVE_VERSION 2
+#define SAVE_HEADER 24
+/* Option constants for board pathfinding */
+#define WALK_VALIDATE 1
+#define WALK_REPLACE 2
+/* Move engines */
+#define ENGINE_CHAR 0   /* board_walk over the char array */
+#define ENGINE_BB64 1   /* one 64-bit bitboard per player, dim <= 8 */
+#define ENGINE_WIDE 2   /* multi-word bitboards, dim <= WIDE_MAX_DIM */
+#define ENGINE_INCR 3   /* char array, valid moves kept up to date per move */
+#define ENGINE_MAX 3
+#define BB64_MAX_DIM 8
+#define WIDE_MAX_DIM 128
+#define WIDE_BITBOARDS 9    /* in one wideBoardType block, o to empty */
+/* Search limits & scores */
+#define SEARCH_MAX_PLY 128
+#define SEARCH_TIME_MS 1000     /* default time per move */
+#define SEARCH_CHECK_NODES 1024 /* nodes between limit checks, at most */
+#define SEARCH_CHECK_US 250     /* aim for a clock check this often */
+#define SEARCH_MAX_THREADS 256
+/* Deadlines: a search is cut off at DEADLINE_HARD of the deadline, & 
+    starts no iteration past a share of it that grows from 
+    DEADLINE_SOFT_MIN at either end of the game to DEADLINE_SOFT_MAX in 
+    the middle, or that it expects to overrun the hard limit with */
+#define DEADLINE_HARD 0.9
+#define DEADLINE_SOFT_MIN 0.2
+#define DEADLINE_SOFT_MAX 0.5
+#define DEADLINE_GROWTH 4       /* least an iteration grows over the last */
+#define DEADLINE_CLOSE 0.8      /* moves taking this share are close calls */
+#define DEADLINE_BUCKETS 101    /* per percent of the deadline, & over it */
+#define ENDGAME_EMPTIES 10      /* default empties to solve exactly from */
+#define SCORE_INF 1000000
+#define SCORE_WIN 100000        /* plus the final disc margin */
+#define SCORE_CORNER 8          /* worth of a corner, in discs */
+/* Monte Carlo tree search */
+#define MCTS_ARENA_MB 64        /* tree size per move */
+#define MCTS_UCT_C 1.4          /* UCT exploration weight */
+#define MCTS_EXPAND_VISITS 2    /* visits to a leaf before it grows */
+#define MCTS_LEAF 0             /* node states */
+#define MCTS_GROWING 1
+#define MCTS_GROWN 2
+/* Transposition table */
+#define TT_DEFAULT_MB 16
+#define TT_BUCKET 4             /* entries per 64-byte cache line */
+#define TT_EXACT 1              /* entry flags; 0 is an empty slot */
+#define TT_LOWER 2
+#define TT_UPPER 3
+#define ZOBRIST_SEED 0x9E3779B97F4A7C15ULL
+#define ZOBRIST_SIDE 0xC3A5C85C97CB3127ULL  /* hashed in when X is to move */
+/* Evaluation: pattern tables of int16 weights, in 1/EVAL_SCALE discs for O.
+    Each corner has a 3x3 block, two edge lines & a diagonal line of up to
+    EVAL_LINE cells; each kind of pattern has one table shared by all 
+    corners, indexed by the cells' digits in base 3 (0 empty, 1 O, 2 X). */
+#define EVAL_FILE "flip%d.eval"     /* default weights for each board size */
+#define EVAL_MAGIC "flipeval"
+#define EVAL_VERSION 1
+#define EVAL_SCALE 16
+#define EVAL_LINE 8
+#define EVAL_PATTERNS 16        /* 4 corner blocks, 8 edges, 4 diagonals */
+#define EVAL_CORNER 0           /* table offsets in the weights */
+#define EVAL_EDGE 19683         /* 3^9 corner block indices */
+#define EVAL_DIAG 26244         /* + 3^8 edge line indices */
+#define EVAL_MOBILITY 32805     /* + 3^8 diagonal line indices */
+#define EVAL_MOVES 64           /* mobility table: moves for the mover */
+#define EVAL_WEIGHTS 32869
+/* Opening book */
+#define BOOK_FILE "flip%d.book"     /* default file for each board size */
+#define BOOK_MAGIC "flipbook"
+#define BOOK_VERSION 1
+/* Cells outside the board */
+#define BOARD_EDGE '#'
+/* Largest board: (n+2)^2 cells, edge & all, still index with an int */
+#define BOARD_MAX_DIM 46338
+/* Cell index of (x,y) & the cell itself */
+#define BOARD_POS(board, x, y) (((x)+1) * (board)->stride + (y)+1)
+#define CELL(board, x, y) ((board)->s[BOARD_POS(board, x, y)])
+/* Profiling rows of calls & cycles, kept only when built with FLIP_STATS. 
+    The macros compile to nothing otherwise; STATS_TIMER declares. */
+#define STATS_MOVEGEN 0     /* game_update_valid_moves, incl. STATS_LIST */
+#define STATS_PUT 1         /* game_put_tile, including STATS_SCORE */
+#define STATS_SCORE 2       /* game_update_scores */
+#define STATS_RENDER 3      /* building & writing output */
+#define STATS_INPUT 4       /* reading & splitting input lines */
+#define STATS_LIST 5        /* game_list_moves, as searches call it */
+#define STATS_ROWS 6
+#ifdef FLIP_STATS
+#define STATS_TIMER(t) uint64_t t;
+#define STATS_START(t) ((t) = stats_clock())
+#define STATS_STOP(game, row, t) \
+    (((game)->stats).cycles[row] += stats_clock() - (t), \
+     ((game)->stats).calls[row]++)
+#define STATS_COUNT(game, counter) (((game)->stats).counter++)
+#else
+#define STATS_TIMER(t)
+#define STATS_START(t) ((void) 0)
+#define STATS_STOP(game, row, t) ((void) 0)
+#define STATS_COUNT(game, counter) ((void) 0)
+#endif
+
+/* Game board: one block of (n+2)*(n+2) cells, where the outer ring is 
+    BOARD_EDGE so that paths stop at the edge without bounds checks */
+typedef struct { 
+    char * s;       /* cells, row by row, including the edge ring */
+    unsigned int n; /* Side length */
+    int stride;     /* cells per row, including the edge ring (n+2) */
+    int dir[8];     /* cell offset along each of the 8 paths from a tile */
+} boardType;
+
+/* Bitboard state for boards up to 8x8: cell (x,y) is bit x*8+y */
+typedef struct {
+    uint64_t o, x;  /* cells held by each player */
+    uint64_t mask;  /* cells inside the board */
+} bitboardType;
+
+/* Multi-word bitboard state: each cell is the bit with the same index as
+    in boardType, so the edge ring bits are never set and paths cannot 
+    wrap around from one row to the next. */
+typedef struct {
+    int words;      /* 64-bit words per bitboard */
+    int steps;      /* doublings needed to cross any run of pieces */
+    int shift[8];   /* bit shift for each path (boardType dir) */
+    uint64_t * o, * x;  /* cells held by each player */
+    uint64_t * mask;    /* cells inside the board */
+    uint64_t * moves, * flips;  /* results of the last query */
+    uint64_t * gen, * pro, * tmp, * empty;  /* scratch space */
+} wideBoardType;
+
+/* Limits on a search AI's work per move (0 = no limit) */
+typedef struct {
+    int depth;      /* plies */
+    long timeMs;    /* wall-clock milliseconds */
+    long nodes;     /* positions visited, or AI_MCTS playouts */
+    long deadlineMs;    /* AI_SEARCH: the whole move, solver & all */
+} searchLimitsType;
+
+/* Result of the last AI_SEARCH or AI_MCTS move, for reports. For AI_MCTS,
+    nodes are playouts, depth is the tree's & score the move's win %. */
+typedef struct {
+    int depth;      /* deepest completed iteration, or empties solved */
+    int score;      /* or the exact final margin, if solved */
+    bool solved;    /* by the endgame solver */
+    bool book;      /* from the opening book: score is the book's */
+    int reply;      /* AI_SEARCH: the best line's answer to the move, or -1 */
+    bool cutOff;    /* stopped by the deadline part way into an iteration */
+    long nodes;     /* positions visited by all threads */
+    double seconds;
+} searchInfoType;
+
+/* Transposition table entry: the top half of the position's Zobrist key
+    checks a match, as the bottom half picks the bucket. The check is 
+    stored XORed with the rest of the entry, so an entry torn by two 
+    threads writing at once just fails to match. Probes check & return a
+    copy, as another thread may write the entry again after the check. */
+typedef struct {
+    uint32_t check;
+    int32_t move;       /* best move found, or -1 */
+    int32_t score;
+    uint8_t depth;
+    uint8_t flag;       /* TT_EXACT, or TT_LOWER/TT_UPPER for a bound */
+    uint8_t age;        /* search it was stored by */
+    uint8_t pad;
+} ttEntryType;
+
+typedef struct {
+    ttEntryType entry[TT_BUCKET];
+} ttBucketType;
+
+/* Transposition table counts, kept by each search thread & summed after */
+typedef struct {
+    long probes, hits, collisions, stores, overwrites;
+} ttStatsType;
+
+/* Fixed-size transposition table & its statistics since the last search */
+typedef struct {
+    ttBucketType * buckets;
+    uint64_t mask;      /* bucket count - 1 (a power of 2) */
+    uint8_t age;
+    ttStatsType stats;  /* all threads' counts, once the search is done */
+} ttType;
+
+/* Weight file: this header, then EVAL_WEIGHTS int16 weights */
+typedef struct {
+    char magic[8];      /* EVAL_MAGIC */
+    uint32_t version;   /* EVAL_VERSION */
+    uint32_t dim;       /* board size the weights were fitted for */
+    uint32_t count;     /* EVAL_WEIGHTS */
+    uint32_t pad;
+} evalHeaderType;
+
+/* A pattern a cell is in, & the cell's place value in its index */
+typedef struct {
+    int pattern;
+    int power;
+} evalRefType;
+
+/* Evaluation tables for a board size, shared by a game & its clones. The
+    patterns each cell is in are refs[cellStart[pos]..cellStart[pos+1]). */
+typedef struct {
+    int16_t * weights;  /* mapped from a file, or the built-in defaults */
+    void * map;         /* the mapping, or NULL */
+    size_t size;
+    int * cellStart;
+    evalRefType * refs;
+} evalType;
+
+/* Opening book file: this header, then the entries sorted by key */
+typedef struct {
+    char magic[8];      /* BOOK_MAGIC */
+    uint32_t version;   /* BOOK_VERSION */
+    uint32_t dim;       /* board size */
+    uint32_t plies;     /* moves from the start covered by the book */
+    uint32_t pad;
+    uint64_t count;     /* entries */
+} bookHeaderType;
+
+/* Book entry: the position's key & move are both taken in the board 
+    symmetry giving the smallest key, so all 8 symmetric positions share
+    an entry */
+typedef struct {
+    uint64_t key;
+    int32_t move;       /* cell index in the canonical orientation */
+    int32_t score;      /* from the search that chose the move */
+} bookEntryType;
+
+/* Opening book mapped into memory, read-only & shared between processes */
+typedef struct {
+    void * map;
+    size_t size;
+    bookHeaderType * header;
+    bookEntryType * entries;
+} bookType;
+
+/* Book being built: its entries & a hash set of the keys already in it
+    (open addressing, 0 marks a free slot) */
+typedef struct {
+    bookEntryType * entries;
+    long count, capacity;
+    uint64_t * seen;
+    uint64_t seenMask;  /* slots - 1 (a power of 2) */
+} bookBuildType;
+
+/* Everything game_unmake_move needs to take back one move or pass */
+typedef struct {
+    int pos;            /* cell played, or -1 for a pass */
+    int nFlips;         /* cells flipped, on top of the flip stack */
+    char whoseTurn;
+    int passes;
+    int scoreO, scoreX, empties, nMoves, nMovesNext;
+    uint64_t hash;
+} undoType;
+
+/* Preallocated stack of made moves & the cells each one flipped */
+typedef struct {
+    undoType * moves;
+    int depth, capacity;
+    int * flips;
+    int nFlips, flipCapacity;
+} undoStackType;
+
+#ifdef FLIP_STATS
+/* Profiling counters for a game, & the searches made on it */
+typedef struct {
+    long calls[STATS_ROWS];
+    uint64_t cycles[STATS_ROWS];
+    long nodes, cutoffs, ttProbes, ttHits;
+} statsType;
+#endif
+
+/* AI_SEARCH moves against the deadline over a game, for tuning it: the
+    close calls, & a histogram of each move's time for the percentiles */
+typedef struct {
+    long moves;
+    long close;         /* took DEADLINE_CLOSE of the deadline or more */
+    long cutOff;        /* stopped by the hard limit */
+    long over;          /* took longer than the deadline */
+    double worst;       /* seconds */
+    long histogram[DEADLINE_BUCKETS];   /* by percent of the deadline */
+} deadlineStatsType;
+
+/* Limit checks during a search every few nodes: fewer nodes apart where
+    they are slow, so that the clock is read about every SEARCH_CHECK_US,
+    & more often as a time limit nears */
+typedef struct {
+    long at;            /* node count due for the next check */
+    long nodes;         /* between checks */
+    double last;        /* clock at the last check */
+} clockCheckType;
+
+/* Full game state */
+struct gameType {
+    int engine; /* move engine: ENGINE_* */
+    int engineOption;   /* engine asked for with --engine, or -1 */
+    int passes; /* if last turn was a pass */
+    int pTypeO, pTypeX; /* player type: 0 (human) to PLAYER_TYPE_MAX */
+    int scoreO, scoreX; /* player scores */
+    int empties;        /* empty cells on the board */
+    int nMoves;         /* valid moves for the current player */
+    int nMovesNext;     /* ENGINE_INCR: valid moves for the other player */
+    char * filepath;    /* filepath last used */
+    char whoseTurn;     /* current player: O,X */
+    boardType board;    /* board state */
+    boardType validMove;/* positions avilable to current player */
+    boardType validNext;/* ENGINE_INCR: positions available to the other */
+    int * changed;      /* cells changed by the last game_put_tile */
+    int nChanged;
+    int * moveList;     /* cells listed by game_list_moves */
+    undoStackType undo; /* moves made by game_make_move */
+    uint64_t hash;      /* Zobrist key of the position & player to move */
+    uint64_t * zobrist; /* key for each cell & player (O, X) */
+    bool isClone;       /* shares zobrist, tt & book with the game it copies */
+    searchLimitsType limits;    /* for AI_SEARCH players */
+    long ttMb;          /* transposition table size */
+    ttType * tt;        /* shared by all searches in the game */
+    int threads;        /* search threads per move */
+    int endgame;        /* AI_SEARCH solves exactly from this many empties */
+    int * abort;        /* set by another thread to end a search, or NULL */
+    uint64_t ponderHash;    /* position searched ahead by pondering, or 0 */
+    double ponderSeconds;   /* spent on it, counted against the search */
+    searchInfoType lastSearch;
+    deadlineStatsType deadline; /* over the game's AI_SEARCH moves */
+    char * bookPath;    /* opening book file, or NULL for BOOK_FILE */
+    bookType * book;    /* opening book for the board size, or NULL */
+    char * evalPath;    /* weight file, or NULL for EVAL_FILE */
+    evalType * eval;    /* evaluation tables for the board size */
+    int32_t evalIndex[EVAL_PATTERNS];   /* weight of each pattern's cells */
+#ifdef FLIP_STATS
+    statsType stats;
+#endif
+    bitboardType bits;  /* board state for ENGINE_BB64 */
+    wideBoardType wide; /* board state for ENGINE_WIDE */
+};
+
+/* Search state shared by all threads searching one move. Each thread 
+    searches the whole tree (Lazy SMP), & the first to finish an 
+    iteration ends it for the rest. */
+typedef struct {
+    pthread_mutex_t lock;   /* guards the best move & line */
+    int * moves;        /* root moves, best guess first */
+    int nMoves;
+    int depth;          /* of the current iteration */
+    int maxDepth;       /* deepest any thread may search */
+    int doneDepth;      /* of the last finished iteration's result */
+    bool finished;      /* a thread has finished this iteration */
+    int alpha;          /* best root score so far */
+    int bestMove;
+    int pv[SEARCH_MAX_PLY];     /* best line so far */
+    int pvLength;
+    searchLimitsType limits;
+    double start;       /* clock at the start of the search */
+    double soft, hard;  /* the deadline's limits by the clock, or 0 */
+    long nodes;         /* counted at each thread's limit checks */
+    int * abort;        /* the game's abort flag, or NULL */
+    bool stop;          /* limits reached: every thread unwinds */
+    bool cutOff;        /* by the deadline's hard limit */
+} searchSharedType;
+
+/* Alpha-beta search state for one thread */
+typedef struct {
+    int id;             /* thread number: 0 for the one playing the game */
+    gameType * game;    /* position being searched, moved by make/unmake */
+    int * moves;        /* root moves, then the lists for each ply below */
+    int nMoves, movesCapacity;
+    int pv[SEARCH_MAX_PLY][SEARCH_MAX_PLY]; /* best line found from each ply */
+    int pvLength[SEARCH_MAX_PLY];
+    int followPv;       /* still on the previous iteration's best line */
+    long nodes;
+    ttStatsType ttStats;
+    clockCheckType check;
+    bool stop;          /* limits reached: unwind without a result */
+    searchSharedType * shared;
+} searchType;
+
+/* Exact endgame solver state. Moves in parity regions (board quarters)
+    with an odd number of empties are tried first: the player who moves 
+    into such a region tends to also get the last move there. */
+typedef struct {
+    gameType * game;
+    long nodes;
+    uint64_t mask;          /* ENGINE_BB64: cells inside the board */
+    uint64_t region[4];     /* ENGINE_BB64: cells in each region */
+    int regionEmpties[4];   /* other engines: empties in each region */
+    int * moves;            /* other engines: move lists for each ply */
+    int nMoves;
+    double stopAt;          /* clock time to give up by, or 0 */
+    clockCheckType check;
+    bool stop;              /* out of time: unwind without a result */
+} solverType;
+
+/* Monte Carlo tree node: the move into it, & playout results for the 
+    player who made that move, in half points. A node's children sit 
+    side by side in the arena. Visits count playouts still in progress,
+    as losses until they finish ("virtual loss"), to spread threads out. */
+typedef struct {
+    int move;           /* cell, or -1 for a pass */
+    int child;          /* first child's index */
+    int nChildren;
+    int state;          /* MCTS_LEAF, MCTS_GROWING or MCTS_GROWN */
+    int visits;
+    int wins;           /* 2 for a win, 1 for a draw */
+} mctsNodeType;
+
+/* Monte Carlo tree search state shared by the playout threads */
+typedef struct {
+    mctsNodeType * nodes;   /* arena of tree nodes; the root is node 0 */
+    int used, capacity;
+    gameType * root;        /* position to search, read only */
+    searchLimitsType limits;
+    double start;
+    long playouts;
+    int stop;
+} mctsSharedType;
+
+/* Monte Carlo tree search state for one thread */
+typedef struct {
+    mctsSharedType * shared;
+    gameType game;      /* reset to the root for each playout */
+    int * path;         /* nodes on the way down the tree */
+    uint64_t random;    /* xorshift state for the rollouts */
+    int depth;          /* deepest node reached */
+} mctsType;
+
+/* ------------------------------------------------------------------------- */
+
+/* 
+    Function prototypes 
+*/
+
+/* AI players & search */
+int ai_choose (int playerType, gameType * game);
+int ai_scan (int playerType, gameType * game);
+int search_move (gameType * game);
+double search_soft_share (gameType * game);
+void search_deadline_record (gameType * game, double seconds);
+int search_reply (gameType * game, searchSharedType * shared, int best);
+int search_root (searchType * search[], int threads, int depth, int * best);
+void * search_root_moves (void * search);
+int search_negamax (searchType * search, int depth, int ply, \
+                    int alpha, int beta);
+int search_eval (gameType * game);
+int search_final (gameType * game);
+void search_check_limits (searchType * search);
+double search_clock_check (clockCheckType * check, long nodes, \
+                           double stopAt);
+double search_clock (void);
+
+/* Evaluation */
+evalType * eval_open (char * fname, boardType * board);
+void eval_close (evalType * eval);
+int eval_save (char * fname, int dim, int16_t * weights);
+void eval_defaults (int16_t * weights);
+void eval_reset (gameType * game);
+void eval_update (int pos, int * flips, int nFlips, char tile, int sign, \
+                  gameType * game);
+int eval_score (gameType * game);
+void eval_kernel_pick (void);
+int eval_sum_scalar (const int32_t * index, const int16_t * weights);
+int eval_sum_avx2 (const int32_t * index, const int16_t * weights);
+
+/* Opening book */
+bookType * book_open (char * fname, int dim);
+void book_close (bookType * book);
+int book_move (gameType * game);
+uint64_t book_key (gameType * game, int * sym);
+int book_transform (int pos, int sym, boardType * board);
+int book_build (gameType * game, int plies, char * fname, long * count);
+void book_build_walk (gameType * game, int plies, bookBuildType * build);
+bool book_build_seen (bookBuildType * build, uint64_t key);
+int book_compare (const void * a, const void * b);
+
+/* Endgame solver */
+int solve_move (gameType * game, double stopAt);
+bool solve_out_of_time (solverType * solver);
+int solve_bb (solverType * solver, uint64_t own, uint64_t opp, \
+              int alpha, int beta, bool passed);
+int solve_bb_last (solverType * solver, uint64_t own, uint64_t opp, \
+                   uint64_t empty);
+int solve_game (solverType * solver, int alpha, int beta);
+int solve_region (int pos, boardType * board);
+int solve_margin (gameType * game);
+
+/* Monte Carlo tree search */
+int mcts_move (gameType * game);
+void * mcts_playouts (void * mcts);
+void mcts_playout (mctsType * mcts);
+int mcts_select (mctsType * mcts, mctsNodeType * node);
+void mcts_grow (mctsType * mcts, mctsNodeType * node);
+int mcts_rollout (mctsType * mcts);
+void mcts_play (int move, gameType * game);
+uint64_t mcts_random (mctsType * mcts);
+
+/* Transposition table */
+ttType * tt_new (long megabytes);
+void tt_free (ttType * tt);
+void tt_new_search (ttType * tt);
+bool tt_probe (ttType * tt, ttStatsType * stats, uint64_t hash, \
+               ttEntryType * entry);
+uint32_t tt_data (ttEntryType * entry);
+void tt_store (ttType * tt, ttStatsType * stats, uint64_t hash, \
+               int depth, int flag, int score, int move);
+void tt_stats_merge (ttStatsType * total, ttStatsType * add);
+void tt_report (ttType * tt);
+
+/* Boardgame engine */
+bool board_walk(int pos, int dir, char tile, boardType * board, int action);
+bool move_valid (int pos, char tile, boardType * board);
+void game_update_valid_moves (gameType * game);
+bool game_move_legal (int pos, gameType * game);
+int game_list_moves (gameType * game);
+void game_put_tile (int pos, gameType * game);
+void game_update_scores (gameType * game);
+void game_update_hash (gameType * game);
+void game_hash_ini (gameType * game);
+void game_set_engine (gameType * game);
+void game_incr_ini (gameType * game);
+void game_incr_recheck (int pos, gameType * game);
+void game_incr_update (gameType * game);
+void game_make_move (int pos, gameType * game);
+void game_make_pass (gameType * game);
+void game_unmake_move (gameType * game);
+undoType * game_push_undo (int pos, gameType * game);
+/**/
+uint64_t bb_shift (uint64_t b, int dir);
+uint64_t bb_valid_moves (uint64_t own, uint64_t opp, uint64_t mask);
+uint64_t bb_flips (int pos, uint64_t own, uint64_t opp);
+int bb_first (uint64_t b);
+int bb_count (uint64_t b);
+int bb_to_pos (int bit, boardType * board);
+int bb_from_pos (int pos, boardType * board);
+/**/
+void wb_ini (wideBoardType * wide, boardType * board);
+void wb_valid_moves (wideBoardType * wide, uint64_t * own, uint64_t * opp);
+void wb_flips (int pos, wideBoardType * wide, uint64_t * own, uint64_t * opp);
+void wb_kernel_ini (void);
+void wb_kernel_pick (void);
+void wb_shift_and_range (uint64_t * dst, const uint64_t * src, int shift, \
+                         const uint64_t * and, int from, int to, int words);
+void wb_shift_and_scalar (uint64_t * dst, const uint64_t * src, int shift, \
+                          const uint64_t * and, int words);
+void wb_shift_and_sse2 (uint64_t * dst, const uint64_t * src, int shift, \
+                        const uint64_t * and, int words);
+void wb_shift_and_avx2 (uint64_t * dst, const uint64_t * src, int shift, \
+                        const uint64_t * and, int words);
+
+/* Game state, memory management and R/W */
+void game_ini (gameType * game);
+void game_set_fname (char * fname, gameType *game);
+int game_load (char * fname, gameType * game);
+int game_load_packed (unsigned char * data, size_t size, gameType * game);
+int game_load_legacy (unsigned char * data, size_t size, gameType * game);
+int game_save (char * fname, gameType * game);
+uint32_t save_checksum (unsigned char * data, size_t size);
+void save_put32 (unsigned char * p, uint32_t value);
+uint32_t save_get32 (unsigned char * p);
+FILE * save_replace_open (char * fname, char ** tmp);
+int save_replace_close (FILE * f, char * tmp, char * fname, bool ok);
+void game_next_player (gameType * game);
+void game_update_scoring (gameType *game);
+void game_lists_ini (gameType * game);
+void game_clone (gameType * dst, gameType * src);
+void game_copy (gameType * dst, gameType * src);
+void game_free (gameType * game);
+/**/
+bool board_ini (boardType * board, unsigned int size);
+void board_cleanup (boardType *board);
+bool board_missing_char (char c, boardType * board);
+void board_free (boardType * board);
+
+/* Profiling counters */
+#ifdef FLIP_STATS
+uint64_t stats_clock (void);
+void stats_merge (statsType * dst, statsType * src);
+#endif
+
+#endif